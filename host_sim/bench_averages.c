@@ -0,0 +1,24 @@
+/**
+ * @file bench_averages.c
+ * @brief The firmware's ambient light and battery averages, built as firmware so bench_funcs can cost them.
+ * @ingroup HOST_SIM
+ * @note MOVING_AVERAGE() and EXP_AVERAGE() generate inline code that lands in the caller. bench_funcs.c is not
+ *       instrumented, so the averages are declared here and built with the firmware's flags.
+ */
+
+#include "bench_averages.h"
+#include "earrings.h"
+#include "moving_average.h"
+
+MOVING_AVERAGE(bench_light, BRIGHTNESS_AVERAGE_SHIFT);
+EXP_AVERAGE(bench_battery, BATTERY_AVERAGE_SHIFT);
+
+uint16_t bench_moving_average_update(uint16_t sample)
+{
+    return bench_light_update(sample);
+}
+
+uint16_t bench_exp_average_update(uint16_t sample)
+{
+    return bench_battery_update(sample);
+}
@@ -0,0 +1,31 @@
+/**
+ * @file bench_averages.h
+ * @brief The firmware's ambient light and battery averages, built as firmware so bench_funcs can cost them.
+ * @ingroup HOST_SIM
+ */
+
+#ifndef BENCH_AVERAGES_H
+#define BENCH_AVERAGES_H
+
+#include <stdint.h>
+
+/** @addtogroup HOST_SIM
+ * @{
+ */
+
+/**
+ * @brief Add a sample to a moving average declared like the firmware's ambient light average.
+ * @param sample New sample.
+ * @return The average of the last 2^BRIGHTNESS_AVERAGE_SHIFT samples.
+ */
+uint16_t bench_moving_average_update(uint16_t sample);
+
+/**
+ * @brief Add a sample to an exponential average declared like the firmware's battery voltage average.
+ * @param sample New sample.
+ * @return The new average.
+ */
+uint16_t bench_exp_average_update(uint16_t sample);
+
+/** @} */
+#endif //BENCH_AVERAGES_H
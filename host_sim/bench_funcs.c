@@ -0,0 +1,447 @@
+/**
+ * @file bench_funcs.c
+ * @brief Per-call cost of the firmware's animation and sensing hot paths on the host simulator, against a baseline.
+ * @ingroup HOST_SIM
+ * @note Built with msp430-elf-gcc instead, the same calls are timed in MCLK cycles on mspdebug's simulator.
+ */
+
+#ifndef __MSP430__
+#include "sim.h"
+#endif
+#include "earrings.h"
+#include "led_control.h"
+#include "brightness_control.h"
+#include "bench_averages.h"
+#include "drivers/gpio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_MAX_FUNCS         16
+#define BENCH_ANIMATION_TICKS   36000   // one pass of the longest sequence, twinkle_one's 9 LEDs x 4000 ticks
+#define BENCH_MV_FROM           3600    // battery sweep, from above a fresh cell ...
+#define BENCH_MV_TO             2000    // ... to below the BATT_LOW cutoff, so the cutoff path runs too
+#define BENCH_TOLERANCE_PCT     5.0     // default: a mean or max this much above the baseline is a regression
+#define BENCH_REPORT_SIZE       1024    // MSP430 build: the text report mspdebug reads back
+
+#ifdef __MSP430__
+/** MCLK cycles of every call to one function, from TB1R running on SMCLK = MCLK. */
+typedef struct
+{
+    uint32_t count;
+    uint32_t total;
+    uint16_t min;
+    uint16_t max;
+} BenchCycles;
+#endif
+
+/** Cost of every call to one function. */
+typedef struct
+{
+    const char *name;
+    const char *range;              // what the calls cover
+#ifdef __MSP430__
+    BenchCycles cost;
+#else
+    SimCostStats cost;
+#endif
+} BenchResult;
+
+// private variables
+static BenchResult results[BENCH_MAX_FUNCS];
+static uint8_t result_count = 0;
+#ifdef __MSP430__
+static uint16_t call_start;
+#else
+static SimCost call_start;
+#endif
+
+#define BENCH_PIN_ENTRY(num, pin, port)     {pin, port},
+static const uint8_t bench_pins[][2] = {{LOW_BATT_LED, LOW_BATT_LED_PORT}, LED_PIN_MAP(BENCH_PIN_ENTRY)};
+
+#ifndef __MSP430__
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --cpi N          MCLK cycles per estimated MSP430 instruction (default 3)\n"
+        "  --baseline FILE  compare with FILE and exit with status 1 on a regression\n"
+        "  --tolerance PCT  rise over the baseline mean or max that counts as a regression (default 5)\n"
+        "  --save FILE      write the results to FILE as the new baseline\n",
+        prog);
+    exit(EXIT_FAILURE);
+}
+#endif
+
+static BenchResult *bench_function(const char *name, const char *range)
+{
+    BenchResult *r = &results[result_count++];
+    r->name = name;
+    r->range = range;
+    return r;
+}
+
+#ifdef __MSP430__
+static void call_begin(void)
+{
+    call_start = TB1R;
+}
+
+static void call_end(BenchResult *r)
+{
+    uint16_t c = TB1R - call_start;
+    BenchCycles *s = &r->cost;
+
+    if (s->count == 0 || c < s->min) s->min = c;
+    if (c > s->max) s->max = c;
+    s->total += c;
+    s->count++;
+}
+#else
+static void call_begin(void)
+{
+    call_start = sim_cost();
+}
+
+static void call_end(BenchResult *r)
+{
+    SimCost now = sim_cost();
+    SimCostStats *s = &r->cost;
+    uint64_t b = now.blocks - call_start.blocks;
+    uint64_t i = now.insns - call_start.insns;
+    uint64_t c = now.cycles - call_start.cycles;
+
+    if (s->count == 0 || i < s->insns_min) s->insns_min = i;
+    if (i > s->insns_max) s->insns_max = i;
+    if (s->count == 0 || c < s->cycles_min) s->cycles_min = c;
+    if (c > s->cycles_max) s->cycles_max = c;
+    s->blocks_total += b;
+    s->insns_total += i;
+    s->cycles_total += c;
+    s->count++;
+}
+#endif
+
+/**
+ * @brief Call every benchmarked function over its whole input range, one BenchResult each.
+ * @note Runs straight after init_earrings(), with interrupts off, so no ISR lands in a measurement. The animation
+ *       functions are called as the tick would call them, so each keeps its own state from call to call.
+ */
+static void run_benchmarks(void)
+{
+    BenchResult *r;
+    uint16_t mv;
+    uint16_t n;
+    uint8_t p;
+
+#if LED_PIPELINE == LED_PIPELINE_FUSED
+    {
+        uint16_t iter = 0;
+        uint8_t end;
+        r = bench_function("sine_single_led", "LED1 over one waveform, brightness 255");
+        do
+        {
+            LedFrame frame = {0, 0};
+            call_begin();
+            end = sine_single_led(1, &iter, 255, &frame);
+            call_end(r);
+        } while (!end);
+    }
+#endif
+
+#if LED_PWM_BACKEND != LED_PWM_TIMER
+    r = bench_function("twinkle_three", "36000 ticks from its start, brightness 255");
+    for (n = 0; n < BENCH_ANIMATION_TICKS; n++)
+    {
+        call_begin();
+        twinkle_three(255);
+        call_end(r);
+    }
+#endif
+    r = bench_function("twinkle_two", "36000 ticks from its start, brightness 255");
+    for (n = 0; n < BENCH_ANIMATION_TICKS; n++)
+    {
+        call_begin();
+        twinkle_two(255);
+        call_end(r);
+    }
+    r = bench_function("twinkle_one", "36000 ticks from its start, brightness 255");
+    for (n = 0; n < BENCH_ANIMATION_TICKS; n++)
+    {
+        call_begin();
+        twinkle_one(255);
+        call_end(r);
+    }
+    stop_animation();
+    turn_off_all_leds();
+
+    // the replacements of update_ma_size_8(): ambient light and battery averages
+    r = bench_function("moving_average_update", "samples 0-1023, from unprimed");
+    for (n = 0; n < 1024; n++)
+    {
+        call_begin();
+        bench_moving_average_update(n);
+        call_end(r);
+    }
+    r = bench_function("exp_average_update", "3600-2000 mV, from unprimed");
+    for (mv = BENCH_MV_FROM; mv >= BENCH_MV_TO; mv--)
+    {
+        call_begin();
+        bench_exp_average_update(mv);
+        call_end(r);
+    }
+
+    r = bench_function("get_scaled_brightness", "brightness 0-255");
+    for (n = 0; n < 256; n++)
+    {
+        call_begin();
+        get_scaled_brightness((uint8_t)n);
+        call_end(r);
+    }
+
+    r = bench_function("batt_low_handler", "3600-2000 mV");
+    for (mv = BENCH_MV_FROM; mv >= BENCH_MV_TO; mv--)
+    {
+        call_begin();
+        batt_low_handler(mv);
+        call_end(r);
+    }
+
+    r = bench_function("set_gpio", "LOW_BATT_LED and LED1-LED9");
+    for (p = 0; p < sizeof(bench_pins) / sizeof(bench_pins[0]); p++)
+    {
+        call_begin();
+        set_gpio(bench_pins[p][0], bench_pins[p][1]);
+        call_end(r);
+    }
+    r = bench_function("clear_gpio", "LOW_BATT_LED and LED1-LED9");
+    for (p = 0; p < sizeof(bench_pins) / sizeof(bench_pins[0]); p++)
+    {
+        call_begin();
+        clear_gpio(bench_pins[p][0], bench_pins[p][1]);
+        call_end(r);
+    }
+}
+
+#ifdef __MSP430__
+char bench_report[BENCH_REPORT_SIZE];   // read back with mspdebug's md command once the CPU stops
+
+/**
+ * @brief Function benchmark entry point on the MSP430: time every call, then write the report and stop.
+ * @return Does not return; LPM4 with interrupts off halts mspdebug's simulator.
+ * @note mspdebug's simulator has no MSP430FR2355 peripherals: the Makefile adds a simio timer at TB1's address, and
+ *       every other register is plain memory, so init_earrings() runs through without waiting on any.
+ */
+int main(void)
+{
+    char *out = bench_report;
+    uint8_t i;
+
+    WDTCTL = WDTPW | WDTHOLD;
+    init_earrings();
+    __disable_interrupt();
+    TB1CCTL0 = 0;
+    TB1CTL = TBSSEL__SMCLK | MC__CONTINUOUS | TBCLR;
+    run_benchmarks();
+
+    out += sprintf(out, "%-22s %6s %20s\n", "function", "calls", "cycles min/mean/max");
+    for (i = 0; i < result_count; i++)
+    {
+        const BenchCycles *s = &results[i].cost;
+        uint32_t mean10 = s->total * 10 / s->count;
+        char cycles[32];
+
+        sprintf(cycles, "%u/%lu.%lu/%u", s->min, (unsigned long)(mean10 / 10), (unsigned long)(mean10 % 10), s->max);
+        out += sprintf(out, "%-22s %6lu %20s\n", results[i].name, (unsigned long)s->count, cycles);
+    }
+
+    __bis_SR_register(LPM4_bits);
+    for (;;);
+}
+#else
+static void save_baseline(const char *path)
+{
+    FILE *f = fopen(path, "w");
+    uint8_t i;
+    if (!f)
+    {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    fprintf(f, "# make bench-funcs-baseline: function, mean and max instructions per call\n");
+    fprintf(f, "# compiler: %s\n", __VERSION__);
+    for (i = 0; i < result_count; i++)
+    {
+        const SimCostStats *s = &results[i].cost;
+        fprintf(f, "%s %.2f %llu\n", results[i].name, (double)s->insns_total / s->count,
+                (unsigned long long)s->insns_max);
+    }
+    fclose(f);
+}
+
+/**
+ * @brief Check that a baseline file was made by the compiler this benchmark was built with.
+ * @return 1 if it was. Block costs follow the host compiler's code, so another compiler's baseline is no reference.
+ */
+static int baseline_compiler_matches(FILE *f)
+{
+    static const char tag[] = "# compiler: ";
+    char line[256];
+
+    rewind(f);
+    while (fgets(line, sizeof(line), f))
+    {
+        if (!strncmp(line, tag, sizeof(tag) - 1))
+        {
+            line[strcspn(line, "\n")] = '\0';
+            if (!strcmp(line + sizeof(tag) - 1, __VERSION__))
+            {
+                return 1;
+            }
+            fprintf(stderr, "bench: baseline from compiler %s, this build is %s\n", line + sizeof(tag) - 1, __VERSION__);
+            return 0;
+        }
+    }
+    fprintf(stderr, "bench: baseline does not say which compiler made it\n");
+    return 0;
+}
+
+/**
+ * @brief Look a function up in a baseline file.
+ * @return 1 if found, with its mean and max instructions per call.
+ */
+static int baseline_of(FILE *f, const char *name, double *mean, double *max)
+{
+    char line[256];
+    char fn[64];
+
+    rewind(f);
+    while (fgets(line, sizeof(line), f))
+    {
+        if (line[0] != '#' && sscanf(line, "%63s %lf %lf", fn, mean, max) == 3 && !strcmp(fn, name))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Print the results, and their change from the baseline when there is one.
+ * @return Number of regressions.
+ * @note The cycles are an estimate, instructions x --cpi plus any FRAM wait states, not a timing of the MSP430. The
+ *       baseline compares instructions only.
+ */
+static int print_results(FILE *baseline, double tolerance_pct)
+{
+    int regressions = 0;
+    uint8_t i;
+
+    printf("%-22s %6s %20s %26s  %s\n", "function", "calls", "insns min/mean/max", "est. cycles (insns x CPI)",
+           baseline ? "vs baseline mean/max" : "range");
+    for (i = 0; i < result_count; i++)
+    {
+        const SimCostStats *s = &results[i].cost;
+        double mean = (double)s->insns_total / s->count;
+        char insns[32], cycles[32];
+
+        snprintf(insns, sizeof(insns), "%llu/%.1f/%llu", (unsigned long long)s->insns_min, mean,
+                 (unsigned long long)s->insns_max);
+        snprintf(cycles, sizeof(cycles), "%llu/%.1f/%llu", (unsigned long long)s->cycles_min,
+                 (double)s->cycles_total / s->count, (unsigned long long)s->cycles_max);
+        printf("%-22s %6llu %20s %26s  ", results[i].name, (unsigned long long)s->count, insns, cycles);
+        if (!baseline)
+        {
+            printf("%s\n", results[i].range);
+            continue;
+        }
+
+        double base_mean, base_max;
+        if (!baseline_of(baseline, results[i].name, &base_mean, &base_max))
+        {
+            printf("new\n");
+            continue;
+        }
+        double d_mean = base_mean > 0 ? 100.0 * (mean - base_mean) / base_mean : 0.0;
+        double d_max = base_max > 0 ? 100.0 * ((double)s->insns_max - base_max) / base_max : 0.0;
+        int regressed = d_mean > tolerance_pct || d_max > tolerance_pct;
+        printf("%+.1f%%/%+.1f%%%s\n", d_mean, d_max, regressed ? "  REGRESSION" : "");
+        regressions += regressed;
+    }
+    return regressions;
+}
+
+/**
+ * @brief Function benchmark entry point.
+ * @param argc Argument count.
+ * @param argv Arguments, see usage().
+ * @return 1 if a function regressed against the baseline, else 0.
+ */
+int main(int argc, char **argv)
+{
+    SimConfig cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.seconds = 1e6;              // firmware time passes with every call, and none of it is spent in LPM
+    cfg.cycles_per_insn = 3.0;
+    cfg.light_level = 32.5;
+    cfg.vbat_mv = 3000;
+    cfg.dvcc_mv = 3300;
+    cfg.xt1_start_ms = 500.0;
+    cfg.battery_mah = SIM_BATTERY_MAH;
+    const char *baseline_path = NULL;
+    const char *save_path = NULL;
+    double tolerance_pct = BENCH_TOLERANCE_PCT;
+
+    int i;
+    for (i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (!val)
+        {
+            usage(argv[0]);
+        }
+        if (!strcmp(arg, "--cpi"))             cfg.cycles_per_insn = atof(val);
+        else if (!strcmp(arg, "--baseline"))   baseline_path = val;
+        else if (!strcmp(arg, "--tolerance"))  tolerance_pct = atof(val);
+        else if (!strcmp(arg, "--save"))       save_path = val;
+        else
+        {
+            usage(argv[0]);
+        }
+        i++;
+    }
+
+    if (!sim_load_own_block_costs((uintptr_t)init_earrings))
+    {
+        fprintf(stderr, "bench: no block cost file, charging %d instructions per block\n", SIM_DEFAULT_BLOCK_INSNS);
+    }
+    sim_reset(&cfg);
+    sim_trace_begin(&cfg);
+    init_earrings();
+    run_benchmarks();
+
+    FILE *baseline = NULL;
+    if (baseline_path && !(baseline = fopen(baseline_path, "r")))
+    {
+        perror(baseline_path);
+        return EXIT_FAILURE;
+    }
+    if (baseline && !baseline_compiler_matches(baseline))
+    {
+        fprintf(stderr, "bench: not comparing across compilers; rerun make bench-funcs-baseline with this one\n");
+        return EXIT_FAILURE;
+    }
+    int regressions = print_results(baseline, tolerance_pct);
+    if (baseline)
+    {
+        fclose(baseline);
+        printf("%d regression%s over %.1f%%\n", regressions, regressions == 1 ? "" : "s", tolerance_pct);
+    }
+    if (save_path)
+    {
+        save_baseline(save_path);
+    }
+    return regressions ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+#endif
@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""Estimate the cost of every instrumented firmware basic block in the host simulator binary.
+
+The firmware objects are compiled with -fsanitize-coverage=trace-pc, so each basic
+block starts with a call to __sanitizer_cov_trace_pc(). This script disassembles the
+linked simulator and, for every such call, counts the instructions that follow it up
+to the end of the block. The result is keyed by the call's return address, which is
+what the simulator sees at run time.
+
+Host instructions are a reasonable stand-in for MSP430 instructions, except that
+multiply and divide are single instructions here and are not on the MSP430. They are
+charged at the cost of an MPY32 operand/result sequence and of the division runtime
+call respectively.
+
+usage: block_costs.py <simulator binary> <anchor symbol> <output file>
+"""
+
+import re
+import subprocess
+import sys
+
+MUL_WEIGHT = 8      # MPY32: load operands, read 32-bit result
+DIV_WEIGHT = 40     # no hardware divider, __mspabi_divu / __mspabi_divul
+TRACE_FN = "__sanitizer_cov_trace_pc"
+
+INSN_RE = re.compile(r"^\s*([0-9a-f]+):\s+(.*)$")
+FUNC_RE = re.compile(r"^([0-9a-f]+) <([^>]+)>:$")
+PREFIXES = ("notrack", "bnd", "lock", "rep", "repz", "repnz", "data16")
+
+
+def mnemonic_of(text):
+    words = text.split()
+    while words and words[0] in PREFIXES:
+        words = words[1:]
+    return words[0] if words else ""
+
+
+def weight_of(mnemonic):
+    if mnemonic.startswith(("imul", "mul")):
+        return MUL_WEIGHT
+    if mnemonic.startswith(("idiv", "div")):
+        return DIV_WEIGHT
+    if mnemonic.startswith("nop") or mnemonic == "endbr64":
+        return 0
+    return 1
+
+
+def ends_block(mnemonic):
+    return mnemonic.startswith("j") or mnemonic.startswith("ret")
+
+
+def main():
+    if len(sys.argv) != 4:
+        sys.exit(__doc__)
+    binary, anchor, out_path = sys.argv[1:]
+
+    dis = subprocess.run(["objdump", "-d", "--no-show-raw-insn", binary],
+                         check=True, capture_output=True, text=True).stdout
+
+    anchor_addr = None
+    blocks = []             # [return address, weight]
+    current = None          # block being counted
+    pending_start = False   # next instruction starts a block
+    prologue = None         # instructions ahead of the function's first block
+
+    for line in dis.splitlines():
+        func = FUNC_RE.match(line)
+        if func:
+            if func.group(2) == anchor:
+                anchor_addr = int(func.group(1), 16)
+            current = None
+            pending_start = False
+            prologue = 0
+            continue
+        insn = INSN_RE.match(line)
+        if not insn:
+            continue
+        addr = int(insn.group(1), 16)
+        text = insn.group(2)
+        mnemonic = mnemonic_of(text)
+
+        if pending_start:
+            # the prologue runs once per call, just like the entry block
+            current = [addr, prologue or 0]
+            blocks.append(current)
+            pending_start = False
+            prologue = None
+
+        if mnemonic.startswith("call") and ("<%s>" % TRACE_FN) in text:
+            current = None
+            pending_start = True
+            continue
+        if prologue is not None:
+            prologue += weight_of(mnemonic)
+        elif current is not None:
+            current[1] += weight_of(mnemonic)
+            if ends_block(mnemonic):
+                current = None
+
+    if anchor_addr is None:
+        sys.exit("block_costs.py: anchor symbol %s not found" % anchor)
+
+    with open(out_path, "w") as out:
+        out.write("anchor %x\n" % anchor_addr)
+        for addr, weight in blocks:
+            out.write("%x %d\n" % (addr, max(weight, 1)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+"""Generate the firmware's perceptual brightness table, space_earrings/led_gamma.c.
+
+Each entry maps a lightness level (0-255, what the animations compute) to the
+LED duty (0-255) that the eye sees as that lightness, using the CIE 1976 L*
+curve: Y = ((L* + 16) / 116)^3 above L* = 8, and Y = L* / 903.3 below it.
+
+The table is committed, so the firmware build does not need Python. Run
+`make gamma-table` after changing this script.
+
+usage: gen_gamma_table.py <output file>
+"""
+
+import sys
+
+ENTRIES = 256
+PER_LINE = 16
+
+
+def cie_duty(level):
+    lightness = level * 100.0 / (ENTRIES - 1)
+    if lightness <= 8.0:
+        luminance = lightness / 903.3
+    else:
+        luminance = ((lightness + 16.0) / 116.0) ** 3
+    return int(round(luminance * (ENTRIES - 1)))
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit(__doc__)
+
+    values = [cie_duty(i) for i in range(ENTRIES)]
+    rows = []
+    for start in range(0, ENTRIES, PER_LINE):
+        rows.append("    " + ", ".join("%3d" % v for v in values[start:start + PER_LINE]))
+
+    with open(sys.argv[1], "w") as out:
+        out.write("""/**
+ * @file led_gamma.c
+ * @brief CIE lightness to LED duty table.
+ * @ingroup LED_GAMMA
+ * @note Generated by host_sim/gen_gamma_table.py - do not edit by hand.
+ */
+
+#include "led_gamma.h"
+
+#if LED_GAMMA == LED_GAMMA_CIE
+// const, so it stays in FRAM
+const uint8_t led_gamma_table[256] = {
+""")
+        out.write(",\n".join(rows))
+        out.write("""
+};
+#endif
+""")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,591 @@
+/**
+ * @file msp430fr2355.h
+ * @brief Host stand-in for the TI MSP430FR2355 device header.
+ *
+ * Every peripheral register the firmware touches is backed by a field of
+ * ::sim_regs. Each register access goes through sim_reg8() / sim_reg16(),
+ * which lets the simulator advance simulated time, update the peripheral
+ * models and deliver pending interrupts, just as they would happen
+ * asynchronously on the real part.
+ *
+ * Bit definitions follow the TI header for every bit the firmware uses. The
+ * model only relies on them being self-consistent.
+ * @ingroup HOST_SIM
+ */
+
+#ifndef SIM_MSP430FR2355_H
+#define SIM_MSP430FR2355_H
+
+#include <stdint.h>
+
+/**
+ * @defgroup HOST_SIM Host simulator
+ * @brief Linux host build of the firmware against a simulated MSP430FR2355.
+ * @{
+ */
+
+/* -------------------------------------
+//      register file
+----------------------------------------*/
+#define SIM_TIMER_COUNT     4
+#define SIM_CCR_COUNT       7
+#define SIM_PORT_COUNT      7 // index 1-6 used, matching the P1-P6 names
+
+typedef struct
+{
+    uint16_t ctl;
+    uint16_t r;
+    uint16_t ex0;
+    uint16_t cctl[SIM_CCR_COUNT];
+    uint16_t ccr[SIM_CCR_COUNT];
+} SimTimerRegs;
+
+typedef struct
+{
+    uint8_t out;
+    uint8_t dir;
+    uint8_t ren;
+    uint8_t sel0;
+    uint8_t sel1;
+    uint8_t ies;
+    uint8_t ie;
+    uint8_t ifg;
+} SimPortRegs;
+
+typedef struct
+{
+    uint16_t wdtctl;
+    uint16_t pm5ctl0;
+    uint16_t sfrie1;
+    uint16_t sfrifg1;
+    uint16_t csctl[9];
+    uint8_t  pmmctl0_h;
+    uint16_t pmmctl2;
+    uint16_t frctl0;
+    uint16_t syscfg0;
+    SimTimerRegs tb[SIM_TIMER_COUNT];
+    SimPortRegs port[SIM_PORT_COUNT];
+    uint16_t adcctl0;
+    uint16_t adcctl1;
+    uint16_t adcctl2;
+    uint16_t adcmctl0;
+    uint16_t adcmem0;
+    uint16_t adclo;
+    uint16_t adchi;
+    uint16_t adcie;
+    uint16_t adcifg;
+    uint16_t cp1ctl0;
+    uint16_t cp1ctl1;
+    uint16_t cp1int;
+    uint16_t cp1dacctl;
+    uint16_t cp1dacdata;
+    uint16_t sac2oa;
+    uint16_t sac2pga;
+} SimRegs;
+
+extern SimRegs sim_regs;
+
+volatile uint8_t *sim_reg8(uint8_t *reg);
+volatile uint16_t *sim_reg16(uint16_t *reg);
+uint8_t sim_port_in(uint8_t port);
+uint16_t sim_read_tbiv(uint8_t timer);
+uint16_t sim_read_adciv(void);
+uint16_t sim_read_cpiv(void);
+
+#define SIM_REG8(field)     (*sim_reg8(&sim_regs.field))
+#define SIM_REG16(field)    (*sim_reg16(&sim_regs.field))
+
+/* -------------------------------------
+//      intrinsics
+----------------------------------------*/
+void sim_bis_sr(uint16_t bits);
+void sim_bic_sr(uint16_t bits);
+void sim_bis_sr_on_exit(uint16_t bits);
+void sim_bic_sr_on_exit(uint16_t bits);
+uint16_t sim_get_sr(void);
+void sim_delay_cycles(uint32_t cycles);
+
+#define __interrupt
+#define __bis_SR_register(x)            sim_bis_sr(x)
+#define __bic_SR_register(x)            sim_bic_sr(x)
+#define __bis_SR_register_on_exit(x)    sim_bis_sr_on_exit(x)
+#define __bic_SR_register_on_exit(x)    sim_bic_sr_on_exit(x)
+#define __get_SR_register()             sim_get_sr()
+#define __enable_interrupt()            sim_bis_sr(GIE)
+#define __disable_interrupt()           sim_bic_sr(GIE)
+#define __delay_cycles(x)               sim_delay_cycles(x)
+#define __no_operation()                sim_delay_cycles(1)
+#define __even_in_range(x, y)           (x)
+#define _NOP()                          __no_operation()
+
+/* -------------------------------------
+//      status register
+----------------------------------------*/
+#define GIE                 (0x0008)
+#define CPUOFF              (0x0010)
+#define OSCOFF              (0x0020)
+#define SCG0                (0x0040)
+#define SCG1                (0x0080)
+
+#define LPM0_bits           (CPUOFF)
+#define LPM1_bits           (SCG0 | CPUOFF)
+#define LPM2_bits           (SCG1 | CPUOFF)
+#define LPM3_bits           (SCG1 | SCG0 | CPUOFF)
+#define LPM4_bits           (SCG1 | SCG0 | OSCOFF | CPUOFF)
+
+#define BIT0                (0x0001)
+#define BIT1                (0x0002)
+#define BIT2                (0x0004)
+#define BIT3                (0x0008)
+#define BIT4                (0x0010)
+#define BIT5                (0x0020)
+#define BIT6                (0x0040)
+#define BIT7                (0x0080)
+#define BIT8                (0x0100)
+#define BIT9                (0x0200)
+#define BITA                (0x0400)
+#define BITB                (0x0800)
+#define BITC                (0x1000)
+#define BITD                (0x2000)
+#define BITE                (0x4000)
+#define BITF                (0x8000)
+
+/* -------------------------------------
+//      SFR, watchdog, PMM, FRAM controller
+----------------------------------------*/
+#define WDTCTL              SIM_REG16(wdtctl)
+#define WDTPW               (0x5A00)
+#define WDTHOLD             (0x0080)
+
+#define SFRIE1              SIM_REG16(sfrie1)
+#define SFRIFG1             SIM_REG16(sfrifg1)
+#define WDTIFG              (0x0001)
+#define OFIFG               (0x0002)
+
+#define PM5CTL0             SIM_REG16(pm5ctl0)
+#define LOCKLPM5            (0x0001)
+
+#define SYSCFG0             SIM_REG16(syscfg0)
+#define FRWPPW              (0xA500)
+#define PFWP                (0x0001)
+#define DFWP                (0x0002)
+
+#define PMMCTL0_H           SIM_REG8(pmmctl0_h)
+#define PMMPW_H             (0xA5)
+#define PMMCTL2             SIM_REG16(pmmctl2)
+#define INTREFEN            (0x0001)
+#define EXTREFEN            (0x0002)
+#define TSENSOREN           (0x0008)
+#define REFGENACT           (0x0100)
+#define REFBGACT            (0x0200)
+#define REFGENRDY           (0x1000)
+#define REFBGRDY            (0x2000)
+
+#define FRCTL0              SIM_REG16(frctl0)
+#define FRCTLPW             (0xA500)
+#define NWAITS              (0x0070)
+#define NWAITS_0            (0x0000)
+#define NWAITS_1            (0x0010)
+#define NWAITS_2            (0x0020)
+
+/* -------------------------------------
+//      clock system
+----------------------------------------*/
+#define CSCTL0              SIM_REG16(csctl[0])
+#define CSCTL1              SIM_REG16(csctl[1])
+#define CSCTL2              SIM_REG16(csctl[2])
+#define CSCTL3              SIM_REG16(csctl[3])
+#define CSCTL4              SIM_REG16(csctl[4])
+#define CSCTL5              SIM_REG16(csctl[5])
+#define CSCTL6              SIM_REG16(csctl[6])
+#define CSCTL7              SIM_REG16(csctl[7])
+#define CSCTL8              SIM_REG16(csctl[8])
+
+#define DISMOD              (0x0001)
+#define DCORSEL             (0x000E)
+#define DCORSEL_0           (0x0000)
+#define DCORSEL_1           (0x0002)
+#define DCORSEL_2           (0x0004)
+#define DCORSEL_3           (0x0006)
+#define DCORSEL_4           (0x0008)
+#define DCORSEL_5           (0x000A)
+#define DCORSEL_6           (0x000C)
+#define DCORSEL_7           (0x000E)
+#define DCOFTRIM0           (0x0010)
+#define DCOFTRIM1           (0x0020)
+#define DCOFTRIM2           (0x0040)
+#define DCOFTRIM_0          (0x0000)
+#define DCOFTRIM_1          (0x0010)
+#define DCOFTRIM_2          (0x0020)
+#define DCOFTRIM_3          (0x0030)
+#define DCOFTRIM_4          (0x0040)
+#define DCOFTRIM_5          (0x0050)
+#define DCOFTRIM_6          (0x0060)
+#define DCOFTRIM_7          (0x0070)
+#define DCOFTRIMEN          (0x0080)
+#define DCOFTRIMEN_0        (0x0000)
+#define DCOFTRIMEN_1        (0x0080)
+
+#define FLLN                (0x03FF)
+#define FLLD                (0x7000)
+#define FLLD_0              (0x0000)
+#define FLLD_1              (0x1000)
+#define FLLD_2              (0x2000)
+#define FLLD_3              (0x3000)
+
+#define FLLREFDIV           (0x0007)
+#define FLLREFDIV_0         (0x0000)
+#define SELREF              (0x0030)
+#define SELREF__XT1CLK      (0x0000)
+#define SELREF__REFOCLK     (0x0010)
+
+#define SELMS               (0x0007)
+#define SELMS__DCOCLKDIV    (0x0000)
+#define SELMS__REFOCLK      (0x0001)
+#define SELMS__XT1CLK       (0x0002)
+#define SELMS__VLOCLK       (0x0003)
+#define SELA                (0x0300)
+#define SELA__XT1CLK        (0x0000)
+#define SELA__REFOCLK       (0x0100)
+#define SELA__VLOCLK        (0x0200)
+
+#define DIVM                (0x0007)
+#define DIVM0               (0x0001)
+#define DIVM1               (0x0002)
+#define DIVM2               (0x0004)
+#define DIVM__1             (0x0000)
+#define DIVM__2             (0x0001)
+#define DIVM__4             (0x0002)
+#define DIVM__8             (0x0003)
+#define DIVS                (0x0030)
+#define DIVS0               (0x0010)
+#define DIVS1               (0x0020)
+#define DIVS__1             (0x0000)
+#define DIVS__2             (0x0010)
+#define DIVS__4             (0x0020)
+#define DIVS__8             (0x0030)
+#define SMCLKOFF            (0x0100)
+
+#define XT1AUTOOFF          (0x0001)
+#define XT1AGCOFF           (0x0002)
+#define XT1BYPASS           (0x0010)
+#define XTS                 (0x0020)
+#define XT1DRIVE            (0x00C0)
+#define XT1DRIVE_0          (0x0000)
+#define XT1DRIVE_3          (0x00C0)
+
+#define DCOFFG              (0x0001)
+#define XT1OFFG             (0x0002)
+#define FLLULIFG            (0x0010)
+#define FLLUNLOCK           (0x0300)
+
+/* -------------------------------------
+//      Timer_B
+----------------------------------------*/
+#define TB0CTL              SIM_REG16(tb[0].ctl)
+#define TB0R                SIM_REG16(tb[0].r)
+#define TB0EX0              SIM_REG16(tb[0].ex0)
+#define TB0CCTL0            SIM_REG16(tb[0].cctl[0])
+#define TB0CCTL1            SIM_REG16(tb[0].cctl[1])
+#define TB0CCTL2            SIM_REG16(tb[0].cctl[2])
+#define TB0CCR0             SIM_REG16(tb[0].ccr[0])
+#define TB0CCR1             SIM_REG16(tb[0].ccr[1])
+#define TB0CCR2             SIM_REG16(tb[0].ccr[2])
+#define TB0IV               (sim_read_tbiv(0))
+
+#define TB1CTL              SIM_REG16(tb[1].ctl)
+#define TB1R                SIM_REG16(tb[1].r)
+#define TB1EX0              SIM_REG16(tb[1].ex0)
+#define TB1CCTL0            SIM_REG16(tb[1].cctl[0])
+#define TB1CCTL1            SIM_REG16(tb[1].cctl[1])
+#define TB1CCTL2            SIM_REG16(tb[1].cctl[2])
+#define TB1CCR0             SIM_REG16(tb[1].ccr[0])
+#define TB1CCR1             SIM_REG16(tb[1].ccr[1])
+#define TB1CCR2             SIM_REG16(tb[1].ccr[2])
+#define TB1IV               (sim_read_tbiv(1))
+
+#define TB2CTL              SIM_REG16(tb[2].ctl)
+#define TB2R                SIM_REG16(tb[2].r)
+#define TB2EX0              SIM_REG16(tb[2].ex0)
+#define TB2CCTL0            SIM_REG16(tb[2].cctl[0])
+#define TB2CCTL1            SIM_REG16(tb[2].cctl[1])
+#define TB2CCTL2            SIM_REG16(tb[2].cctl[2])
+#define TB2CCR0             SIM_REG16(tb[2].ccr[0])
+#define TB2CCR1             SIM_REG16(tb[2].ccr[1])
+#define TB2CCR2             SIM_REG16(tb[2].ccr[2])
+#define TB2IV               (sim_read_tbiv(2))
+
+#define TB3CTL              SIM_REG16(tb[3].ctl)
+#define TB3R                SIM_REG16(tb[3].r)
+#define TB3EX0              SIM_REG16(tb[3].ex0)
+#define TB3CCTL0            SIM_REG16(tb[3].cctl[0])
+#define TB3CCTL1            SIM_REG16(tb[3].cctl[1])
+#define TB3CCTL2            SIM_REG16(tb[3].cctl[2])
+#define TB3CCTL3            SIM_REG16(tb[3].cctl[3])
+#define TB3CCTL4            SIM_REG16(tb[3].cctl[4])
+#define TB3CCTL5            SIM_REG16(tb[3].cctl[5])
+#define TB3CCTL6            SIM_REG16(tb[3].cctl[6])
+#define TB3CCR0             SIM_REG16(tb[3].ccr[0])
+#define TB3CCR1             SIM_REG16(tb[3].ccr[1])
+#define TB3CCR2             SIM_REG16(tb[3].ccr[2])
+#define TB3CCR3             SIM_REG16(tb[3].ccr[3])
+#define TB3CCR4             SIM_REG16(tb[3].ccr[4])
+#define TB3CCR5             SIM_REG16(tb[3].ccr[5])
+#define TB3CCR6             SIM_REG16(tb[3].ccr[6])
+#define TB3IV               (sim_read_tbiv(3))
+
+#define TBIFG               (0x0001)
+#define TBIE                (0x0002)
+#define TBCLR               (0x0004)
+#define MC                  (0x0030)
+#define MC__STOP            (0x0000)
+#define MC__UP              (0x0010)
+#define MC__CONTINUOUS      (0x0020)
+#define MC__UPDOWN          (0x0030)
+#define ID                  (0x00C0)
+#define ID__1               (0x0000)
+#define ID__2               (0x0040)
+#define ID__4               (0x0080)
+#define ID__8               (0x00C0)
+#define TBSSEL              (0x0300)
+#define TBSSEL__TBCLK       (0x0000)
+#define TBSSEL__ACLK        (0x0100)
+#define TBSSEL__SMCLK       (0x0200)
+#define TBSSEL__INCLK       (0x0300)
+#define TBIDEX              (0x0007)
+
+#define CCIFG               (0x0001)
+#define COV                 (0x0002)
+#define OUT                 (0x0004)
+#define CCI                 (0x0008)
+#define CCIE                (0x0010)
+#define OUTMOD              (0x00E0)
+#define OUTMOD_0            (0x0000)
+#define OUTMOD_1            (0x0020)
+#define OUTMOD_2            (0x0040)
+#define OUTMOD_3            (0x0060)
+#define OUTMOD_4            (0x0080)
+#define OUTMOD_5            (0x00A0)
+#define OUTMOD_6            (0x00C0)
+#define OUTMOD_7            (0x00E0)
+#define CAP                 (0x0100)
+
+#define TBIV__NONE          (0x0000)
+#define TBIV__TBCCR1        (0x0002)
+#define TBIV__TBCCR2        (0x0004)
+#define TBIV__TBCCR3        (0x0006)
+#define TBIV__TBCCR4        (0x0008)
+#define TBIV__TBCCR5        (0x000A)
+#define TBIV__TBCCR6        (0x000C)
+#define TBIV__TBIFG         (0x000E)
+
+/* -------------------------------------
+//      digital I/O
+----------------------------------------*/
+#define SIM_PORT_REG(p, field)  SIM_REG8(port[p].field)
+
+#define P1IN                (sim_port_in(1))
+#define P1OUT               SIM_PORT_REG(1, out)
+#define P1DIR               SIM_PORT_REG(1, dir)
+#define P1REN               SIM_PORT_REG(1, ren)
+#define P1SEL0              SIM_PORT_REG(1, sel0)
+#define P1SEL1              SIM_PORT_REG(1, sel1)
+#define P1IES               SIM_PORT_REG(1, ies)
+#define P1IE                SIM_PORT_REG(1, ie)
+#define P1IFG               SIM_PORT_REG(1, ifg)
+
+#define P2IN                (sim_port_in(2))
+#define P2OUT               SIM_PORT_REG(2, out)
+#define P2DIR               SIM_PORT_REG(2, dir)
+#define P2REN               SIM_PORT_REG(2, ren)
+#define P2SEL0              SIM_PORT_REG(2, sel0)
+#define P2SEL1              SIM_PORT_REG(2, sel1)
+#define P2IES               SIM_PORT_REG(2, ies)
+#define P2IE                SIM_PORT_REG(2, ie)
+#define P2IFG               SIM_PORT_REG(2, ifg)
+
+#define P3IN                (sim_port_in(3))
+#define P3OUT               SIM_PORT_REG(3, out)
+#define P3DIR               SIM_PORT_REG(3, dir)
+#define P3REN               SIM_PORT_REG(3, ren)
+#define P3SEL0              SIM_PORT_REG(3, sel0)
+#define P3SEL1              SIM_PORT_REG(3, sel1)
+#define P3IES               SIM_PORT_REG(3, ies)
+#define P3IE                SIM_PORT_REG(3, ie)
+#define P3IFG               SIM_PORT_REG(3, ifg)
+
+#define P4IN                (sim_port_in(4))
+#define P4OUT               SIM_PORT_REG(4, out)
+#define P4DIR               SIM_PORT_REG(4, dir)
+#define P4REN               SIM_PORT_REG(4, ren)
+#define P4SEL0              SIM_PORT_REG(4, sel0)
+#define P4SEL1              SIM_PORT_REG(4, sel1)
+#define P4IES               SIM_PORT_REG(4, ies)
+#define P4IE                SIM_PORT_REG(4, ie)
+#define P4IFG               SIM_PORT_REG(4, ifg)
+
+#define P5IN                (sim_port_in(5))
+#define P5OUT               SIM_PORT_REG(5, out)
+#define P5DIR               SIM_PORT_REG(5, dir)
+#define P5REN               SIM_PORT_REG(5, ren)
+#define P5SEL0              SIM_PORT_REG(5, sel0)
+#define P5SEL1              SIM_PORT_REG(5, sel1)
+
+#define P6IN                (sim_port_in(6))
+#define P6OUT               SIM_PORT_REG(6, out)
+#define P6DIR               SIM_PORT_REG(6, dir)
+#define P6REN               SIM_PORT_REG(6, ren)
+#define P6SEL0              SIM_PORT_REG(6, sel0)
+#define P6SEL1              SIM_PORT_REG(6, sel1)
+
+/* -------------------------------------
+//      ADC
+----------------------------------------*/
+#define ADCCTL0             SIM_REG16(adcctl0)
+#define ADCCTL1             SIM_REG16(adcctl1)
+#define ADCCTL2             SIM_REG16(adcctl2)
+#define ADCMCTL0            SIM_REG16(adcmctl0)
+#define ADCMEM0             SIM_REG16(adcmem0)
+#define ADCLO               SIM_REG16(adclo)
+#define ADCHI               SIM_REG16(adchi)
+#define ADCIE               SIM_REG16(adcie)
+#define ADCIFG              SIM_REG16(adcifg)
+#define ADCIV               (sim_read_adciv())
+
+#define ADCSC               (0x0001)
+#define ADCENC              (0x0002)
+#define ADCON               (0x0010)
+#define ADCMSC              (0x0080)
+#define ADCSHT              (0x0F00)
+#define ADCSHT_0            (0x0000)
+#define ADCSHT_1            (0x0100)
+#define ADCSHT_2            (0x0200)
+#define ADCSHT_3            (0x0300)
+#define ADCSHT_4            (0x0400)
+#define ADCSHT_8            (0x0800)
+
+#define ADCBUSY             (0x0001)
+#define ADCCONSEQ           (0x0006)
+#define ADCCONSEQ_0         (0x0000)
+#define ADCCONSEQ_1         (0x0002)
+#define ADCCONSEQ_2         (0x0004)
+#define ADCCONSEQ_3         (0x0006)
+#define ADCSSEL             (0x0018)
+#define ADCSSEL_0           (0x0000)
+#define ADCSSEL_1           (0x0008)
+#define ADCSSEL_2           (0x0010)
+#define ADCSHP              (0x0200)
+#define ADCSHS              (0x0C00)
+#define ADCSHS_0            (0x0000)
+#define ADCSHS_1            (0x0400)
+#define ADCSHS_2            (0x0800)
+#define ADCSHS_3            (0x0C00)
+
+#define ADCDF               (0x0008)
+#define ADCRES              (0x0030)
+#define ADCRES_0            (0x0000)
+#define ADCRES_1            (0x0010)
+#define ADCRES_2            (0x0020)
+
+#define ADCINCH             (0x000F)
+#define ADCINCH_0           (0x0000)
+#define ADCINCH_1           (0x0001)
+#define ADCINCH_12          (0x000C)
+#define ADCINCH_13          (0x000D)
+#define ADCINCH_14          (0x000E)
+#define ADCINCH_15          (0x000F)
+#define ADCSREF             (0x0070)
+#define ADCSREF_0           (0x0000)
+#define ADCSREF_1           (0x0010)
+
+#define ADCIE0              (0x0001)
+#define ADCOVIE             (0x0002)
+#define ADCTOVIE            (0x0004)
+#define ADCLOIE             (0x0008)
+#define ADCINIE             (0x0010)
+#define ADCHIIE             (0x0020)
+
+#define ADCIFG0             (0x0001)
+#define ADCOVIFG            (0x0002)
+#define ADCTOVIFG           (0x0004)
+#define ADCLOIFG            (0x0008)
+#define ADCINIFG            (0x0010)
+#define ADCHIIFG            (0x0020)
+
+#define ADCIV_NONE          (0x0000)
+#define ADCIV_ADCOVIFG      (0x0002)
+#define ADCIV_ADCTOVIFG     (0x0004)
+#define ADCIV_ADCHIIFG      (0x0006)
+#define ADCIV_ADCLOIFG      (0x0008)
+#define ADCIV_ADCINIFG      (0x000A)
+#define ADCIV_ADCIFG        (0x000C)
+
+/* -------------------------------------
+//      eCOMP1 and SAC2
+----------------------------------------*/
+#define CP1CTL0             SIM_REG16(cp1ctl0)
+#define CP1CTL1             SIM_REG16(cp1ctl1)
+#define CP1INT              SIM_REG16(cp1int)
+#define CP1IV               (sim_read_cpiv())
+#define CP1DACCTL           SIM_REG16(cp1dacctl)
+#define CP1DACDATA          SIM_REG16(cp1dacdata)
+
+#define CPPSEL              (0x0007)
+#define CPPSEL_0            (0x0000)
+#define CPPSEL_1            (0x0001)
+#define CPPSEL_6            (0x0006)
+#define CPPEN               (0x0010)
+#define CPNSEL              (0x0700)
+#define CPNSEL_0            (0x0000)
+#define CPNSEL_1            (0x0100)
+#define CPNSEL_6            (0x0600)
+#define CPNEN               (0x1000)
+
+#define CPOUT               (0x0001)
+#define CPINV               (0x0002)
+#define CPIES               (0x0004)
+#define CPFLT               (0x0008)
+#define CPMSEL              (0x0040)
+#define CPHSEL0             (0x0100)
+#define CPHSEL1             (0x0200)
+#define CPEN                (0x0800)
+#define CPIE                (0x4000)
+#define CPIIE               (0x8000)
+
+#define CPIFG               (0x0001)
+#define CPIIFG              (0x0002)
+
+#define CPIV__NONE          (0x0000)
+#define CPIV__CPIFG         (0x0002)
+#define CPIV__CPIIFG        (0x0004)
+
+#define CPDACEN             (0x0001)
+#define CPDACREFS           (0x0002)
+#define CPDACSW             (0x0004)
+#define CPDACBUFS           (0x0008)
+
+#define SAC2OA              SIM_REG16(sac2oa)
+#define SAC2PGA             SIM_REG16(sac2pga)
+#define PMUXEN              (0x0008)
+#define NMUXEN              (0x0080)
+#define OAEN                (0x0100)
+#define OAPM                (0x0200)
+#define SACEN               (0x0400)
+
+/* -------------------------------------
+//      interrupt vectors (only named by #pragma vector, which the host ignores)
+----------------------------------------*/
+#define PORT4_VECTOR            (22)
+#define ECOMP0_ECOMP1_VECTOR    (28)
+#define ADC_VECTOR              (29)
+#define TIMER3_B1_VECTOR        (36)
+#define TIMER3_B0_VECTOR        (37)
+#define TIMER2_B1_VECTOR        (38)
+#define TIMER2_B0_VECTOR        (39)
+#define TIMER1_B1_VECTOR        (40)
+#define TIMER1_B0_VECTOR        (41)
+#define TIMER0_B1_VECTOR        (42)
+#define TIMER0_B0_VECTOR        (43)
+
+/** @} */
+#endif // SIM_MSP430FR2355_H
@@ -0,0 +1,35 @@
+#!/usr/bin/env python3
+"""Print the NUL-terminated text in an mspdebug "md" memory dump.
+
+make bench-funcs reads the MSP430 build's report out of mspdebug's simulator
+this way: the firmware writes it into a RAM buffer and stops, and mspdebug
+dumps the buffer as hex lines of the form
+
+    0x2000: 66 75 6e 63 74 69 6f 6e 20 20 20 20 20 20 20 20 |function        |
+
+usage: mspdebug ... "md <symbol> <length>" | mspdebug_text.py
+"""
+
+import re
+import sys
+
+DUMP_RE = re.compile(r"^\s*(?:0x)?[0-9a-fA-F]+:\s+((?:[0-9a-fA-F]{2}\s+)+)")
+
+
+def main():
+    text = bytearray()
+    for line in sys.stdin:
+        m = DUMP_RE.match(line)
+        if not m:
+            continue
+        for byte in m.group(1).split():
+            if byte == "00":
+                sys.stdout.write(text.decode("ascii", "replace"))
+                return 0
+            text.append(int(byte, 16))
+    sys.stdout.write(text.decode("ascii", "replace"))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
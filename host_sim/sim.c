@@ -0,0 +1,1265 @@
+/**
+ * @file sim.c
+ * @brief Simulated MSP430FR2355 core: time base, peripherals, interrupts and cost accounting.
+ * @ingroup HOST_SIM
+ *
+ * Simulated time is counted in ACLK ticks (32.768 kHz), which is the clock both
+ * firmware timers run from. The firmware is compiled with
+ * -fsanitize-coverage=trace-pc, so every basic block it executes calls
+ * __sanitizer_cov_trace_pc(). Each block is charged the instruction estimate
+ * block_costs.py derived for it; multiplied by cycles_per_insn that gives the
+ * MCLK cycle estimate, which is converted back into simulated time. A tick
+ * handler that runs too long therefore really does delay or miss the next tick.
+ */
+
+#include "sim.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SIM_ISR_OVERHEAD_CYCLES     11      // 6 cycles interrupt acceptance + 5 cycles RETI
+#define SIM_NO_EVENT                UINT64_MAX
+#define SIM_SWITCH_RELEASE_MS       50.0
+
+SimRegs sim_regs;
+SimStats sim_stats;
+SimPin sim_pins[SIM_MAX_PINS];
+uint8_t sim_pin_count = 0;
+
+const char *const sim_source_names[SIM_SRC_COUNT] = {
+    "TIMER0_B0", "TIMER0_B1", "TIMER1_B0", "TIMER1_B1",
+    "TIMER2_B0", "TIMER2_B1", "TIMER3_B0", "TIMER3_B1",
+    "ADC", "ECOMP", "PORT4"
+};
+
+const char *const sim_load_names[SIM_LOAD_COUNT] = {
+    "leds", "adc", "ref", "ecomp", "sac", "refo"
+};
+
+// firmware interrupt handlers, bound by name since the host ignores #pragma vector
+extern void Timer0_B0_ISR(void) __attribute__((weak));
+extern void Timer0_B1_ISR(void) __attribute__((weak));
+extern void Timer1_B0_ISR(void) __attribute__((weak));
+extern void Timer1_B1_ISR(void) __attribute__((weak));
+extern void Timer2_B0_ISR(void) __attribute__((weak));
+extern void Timer2_B1_ISR(void) __attribute__((weak));
+extern void Timer3_B0_ISR(void) __attribute__((weak));
+extern void Timer3_B1_ISR(void) __attribute__((weak));
+extern void ADC_ISR(void) __attribute__((weak));
+extern void ECOMP1_ISR(void) __attribute__((weak));
+extern void Port_4_ISR(void) __attribute__((weak));
+
+static void (*const isr_table[SIM_SRC_COUNT])(void) = {
+    Timer0_B0_ISR, Timer0_B1_ISR, Timer1_B0_ISR, Timer1_B1_ISR,
+    Timer2_B0_ISR, Timer2_B1_ISR, Timer3_B0_ISR, Timer3_B1_ISR,
+    ADC_ISR, ECOMP1_ISR, Port_4_ISR
+};
+
+static const uint8_t timer_ccr_count[SIM_TIMER_COUNT] = {3, 3, 3, 7};
+
+/** A Timer_B output and the pin it drives when the port's PxSEL bits select it. */
+typedef struct
+{
+    uint8_t port;
+    uint8_t mask;
+    uint8_t timer;
+    uint8_t ccr;
+} SimTimerPin;
+
+static const SimTimerPin timer_pins[] = {
+    {1, BIT6, 0, 1}, {1, BIT7, 0, 2},
+    {6, BIT0, 3, 1}, {6, BIT1, 3, 2}, {6, BIT2, 3, 3}, {6, BIT3, 3, 4}, {6, BIT4, 3, 5}, {6, BIT5, 3, 6}
+};
+
+// private variables
+static const SimConfig *cfg;
+static jmp_buf exit_jmp;
+static uint64_t end_ticks;
+static uint16_t sr;
+static uint16_t *isr_sr;                 // saved SR of the running ISR, NULL in main context
+
+static uint64_t blocks;                  // firmware basic blocks executed
+static uint64_t insns;                   // estimated MSP430 instructions executed
+static uint64_t wait_insns;              // instructions run from FRAM x NWAITS at the time
+static uint64_t synced_ram_insns;        // sim_stats.ram_insns already charged for
+static uint64_t extra_cycles;            // delay cycles and interrupt overhead
+static uint64_t synced_cycles;           // cycles already converted into simulated time
+static double tick_frac;                 // fraction of an ACLK tick executed but not yet worth a whole tick
+static uint8_t sync_pending;
+static uint8_t in_fram;                  // the latest block is FRAM code, not RAMFUNC
+
+static uint8_t awake;
+static uint64_t wake_start_tick;
+static uint64_t wake_start_blocks;
+static uint64_t wake_start_insns;
+static uint64_t wake_start_cycles;
+static uint32_t wake_sources;
+
+static uint32_t timer_prescale[SIM_TIMER_COUNT];
+static uint8_t timer_out[SIM_TIMER_COUNT][7]; // output latch of each compare channel
+static uint8_t adc_busy;
+static uint64_t adc_done_at;
+static uint8_t adc_inside;                // the latest conversion was inside [ADCLO, ADCHI]
+static uint8_t tb1_rising;                // TB1.x outputs that have risen since adc_update() last looked, by bit
+static uint8_t comp_out;
+static uint8_t switch_pressed;
+static uint8_t xt1_enabled;
+static uint64_t xt1_stable_at;
+static uint8_t next_press;
+static uint16_t bounce_left;             // press edges still to come from the bouncing contact
+static uint64_t switch_release_at;
+
+// per-block instruction estimates, sorted by address, with a direct-mapped lookup cache
+#define BLOCK_CACHE_SIZE    4096u
+typedef struct
+{
+    uintptr_t pc;
+    uint32_t insns;
+} BlockCost;
+static BlockCost *block_costs = NULL;
+static size_t block_cost_count = 0;
+static BlockCost block_cache[BLOCK_CACHE_SIZE];
+
+// RAMFUNC code, placed in the sim_ramfunc section by the Makefile; the linker defines these if it is not empty
+extern const char __start_sim_ramfunc[] __attribute__((weak));
+extern const char __stop_sim_ramfunc[] __attribute__((weak));
+
+// private functions
+static void sim_sync(void);
+static void check_fram_speed(void);
+static void advance(uint64_t ticks);
+
+/* -------------------------------------
+//      cost accounting
+----------------------------------------*/
+static int compare_block_cost(const void *a, const void *b)
+{
+    uintptr_t pa = ((const BlockCost *)a)->pc;
+    uintptr_t pb = ((const BlockCost *)b)->pc;
+    return (pa > pb) - (pa < pb);
+}
+
+int sim_load_block_costs(const char *path, uintptr_t anchor)
+{
+    FILE *f = fopen(path, "r");
+    unsigned long long file_anchor;
+    if (!f)
+    {
+        return 0;
+    }
+    if (fscanf(f, "anchor %llx", &file_anchor) != 1)
+    {
+        fclose(f);
+        return 0;
+    }
+
+    size_t capacity = 1024;
+    block_costs = malloc(capacity * sizeof(BlockCost));
+    block_cost_count = 0;
+    unsigned long long pc;
+    unsigned weight;
+    while (block_costs && fscanf(f, "%llx %u", &pc, &weight) == 2)
+    {
+        if (block_cost_count == capacity)
+        {
+            capacity *= 2;
+            block_costs = realloc(block_costs, capacity * sizeof(BlockCost));
+            if (!block_costs)
+            {
+                break;
+            }
+        }
+        block_costs[block_cost_count].pc = (uintptr_t)(pc - file_anchor) + anchor;
+        block_costs[block_cost_count].insns = weight;
+        block_cost_count++;
+    }
+    fclose(f);
+    if (!block_costs)
+    {
+        block_cost_count = 0;
+        return 0;
+    }
+    qsort(block_costs, block_cost_count, sizeof(BlockCost), compare_block_cost);
+    memset(block_cache, 0, sizeof(block_cache));
+    return 1;
+}
+
+int sim_load_own_block_costs(uintptr_t anchor)
+{
+    // block_costs.py output sits next to the binary
+    char path[4096];
+    ssize_t len = readlink("/proc/self/exe", path, sizeof(path) - sizeof(".costs"));
+    if (len < 0)
+    {
+        return 0;
+    }
+    path[len] = '\0';
+    strcat(path, ".costs");
+    return sim_load_block_costs(path, anchor);
+}
+
+static uint32_t block_insns(uintptr_t pc)
+{
+    BlockCost *slot = &block_cache[(pc >> 1) & (BLOCK_CACHE_SIZE - 1)];
+    if (slot->pc == pc)
+    {
+        return slot->insns;
+    }
+
+    BlockCost key = {pc, 0};
+    BlockCost *hit = block_cost_count ?
+        bsearch(&key, block_costs, block_cost_count, sizeof(BlockCost), compare_block_cost) : NULL;
+    slot->pc = pc;
+    slot->insns = hit ? hit->insns : SIM_DEFAULT_BLOCK_INSNS;
+    return slot->insns;
+}
+
+/**
+ * @brief Coverage callback inserted by the compiler at every firmware basic block.
+ * @note A register write is only visible once the accessor has returned, so the
+ *       deferred sync here lets its side effects happen before the next block runs.
+ */
+void __sanitizer_cov_trace_pc(void)
+{
+    uintptr_t pc = (uintptr_t)__builtin_return_address(0);
+    uint32_t n = block_insns(pc);
+
+    blocks++;
+    insns += n;
+    in_fram = !(pc >= (uintptr_t)__start_sim_ramfunc && pc < (uintptr_t)__stop_sim_ramfunc);
+    if (!in_fram)
+    {
+        sim_stats.ram_insns += n;
+    }
+    else
+    {
+        wait_insns += (uint64_t)n * ((sim_regs.frctl0 & NWAITS) >> 4);
+        check_fram_speed();
+    }
+    if (sync_pending)
+    {
+        sync_pending = 0;
+        sim_sync();
+    }
+}
+
+static uint64_t total_cycles(void)
+{
+    return (uint64_t)((double)insns * cfg->cycles_per_insn + (double)wait_insns * SIM_FRAM_MISSES_PER_INSN) +
+           extra_cycles;
+}
+
+SimCost sim_cost(void)
+{
+    SimCost c = {blocks, insns, total_cycles()};
+    return c;
+}
+
+static void cost_add(SimCostStats *s, uint64_t b, uint64_t i, uint64_t c)
+{
+    if (s->count == 0 || i < s->insns_min) s->insns_min = i;
+    if (i > s->insns_max) s->insns_max = i;
+    if (s->count == 0 || c < s->cycles_min) s->cycles_min = c;
+    if (c > s->cycles_max) s->cycles_max = c;
+    s->blocks_total += b;
+    s->insns_total += i;
+    s->cycles_total += c;
+    s->count++;
+}
+
+/**
+ * @brief Convert MCLK cycles executed since the last call into simulated time.
+ */
+static void charge_time(void)
+{
+    uint64_t cycles = total_cycles();
+    if (cycles != synced_cycles)
+    {
+        uint32_t mclk = sim_mclk_hz();
+        double ram_cycles = (double)(sim_stats.ram_insns - synced_ram_insns) * cfg->cycles_per_insn;
+        double all_cycles = (double)(cycles - synced_cycles);
+
+        // everything not run from RAM - FRAM code, its wait states, delays, interrupt entry - counts as FRAM
+        if (ram_cycles > all_cycles)
+        {
+            ram_cycles = all_cycles;
+        }
+        sim_stats.active_uc += SIM_I_ACTIVE_UA * all_cycles / mclk +
+                               (SIM_Q_RAM_CYCLE_PC * ram_cycles + SIM_Q_FRAM_CYCLE_PC * (all_cycles - ram_cycles)) * 1e-6;
+        synced_ram_insns = sim_stats.ram_insns;
+        // kept as time rather than cycles, since MCLK may be different when the remainder is next added to
+        tick_frac += all_cycles * SIM_ACLK_HZ / mclk;
+        synced_cycles = cycles;
+        uint64_t ticks = (uint64_t)tick_frac;
+        tick_frac -= (double)ticks;
+        if (ticks)
+        {
+            advance(ticks);
+        }
+    }
+}
+
+static void wake_begin(void)
+{
+    awake = 1;
+    wake_start_tick = sim_stats.now;
+    wake_start_blocks = blocks;
+    wake_start_insns = insns;
+    wake_start_cycles = total_cycles();
+    wake_sources = 0;
+}
+
+static void wake_end(void)
+{
+    if (!awake)
+    {
+        return;
+    }
+    charge_time();
+    uint64_t b = blocks - wake_start_blocks;
+    uint64_t i = insns - wake_start_insns;
+    uint64_t c = total_cycles() - wake_start_cycles;
+    sim_stats.wakeups++;
+    sim_stats.active_cycles += c;
+    sim_stats.active_ticks += sim_stats.now - wake_start_tick;
+    cost_add(&sim_stats.all, b, i, c);
+    if (wake_sources & (1u << SIM_SRC_TIMER0_B0))
+    {
+        cost_add(&sim_stats.tick, b, i, c);
+    }
+    sim_trace_wake(sim_stats.wakeups, wake_start_tick, wake_sources, b, i, c);
+    awake = 0;
+}
+
+/* -------------------------------------
+//      clock system
+----------------------------------------*/
+uint32_t sim_dco_hz(void)
+{
+    static const uint16_t fll_ref_div[8] = {1, 32, 64, 128, 256, 512, 512, 512};
+
+    // FLL locks DCOCLKDIV to (FLLN + 1) * fFLLREFCLK / n
+    uint32_t flln = (sim_regs.csctl[2] & FLLN) + 1;
+    return flln * SIM_ACLK_HZ / fll_ref_div[sim_regs.csctl[3] & FLLREFDIV];
+}
+
+uint32_t sim_mclk_hz(void)
+{
+    uint16_t sel = sim_regs.csctl[4] & SELMS;
+    uint32_t src;
+
+    if (sel == SELMS__DCOCLKDIV)
+    {
+        src = sim_dco_hz();
+    }
+    else if (sel == SELMS__VLOCLK)
+    {
+        src = 10000;
+    }
+    else
+    {
+        src = SIM_ACLK_HZ;
+    }
+    return src >> (sim_regs.csctl[5] & DIVM);
+}
+
+double sim_ticks_to_s(uint64_t ticks)
+{
+    return (double)ticks / SIM_ACLK_HZ;
+}
+
+/**
+ * @brief Model XT1 start-up: the oscillator runs while P2.6/P2.7 select the crystal and something requests it, and
+ *        reports a fault until cfg->xt1_start_ms after that. Clearing XT1OFFG or OFIFG before then has no effect, as
+ *        on the device.
+ * @note XT1 is requested by ACLK or the FLL selecting it, or by clearing XT1AUTOOFF; with XT1AUTOOFF set (its reset
+ *       value) and neither selecting it, the oscillator stays off.
+ * @note Both ACLK sources are 32.768 kHz, so the time base does not change when the firmware switches between them.
+ *       Out of reset ACLK and the FLL select XT1 and fail safe to REFO while it faults, which needs no modelling either.
+ */
+static void clock_update(void)
+{
+    uint8_t requested = !(sim_regs.csctl[6] & XT1AUTOOFF) || (sim_regs.csctl[4] & SELA) == SELA__XT1CLK ||
+                        (sim_regs.csctl[3] & SELREF) == SELREF__XT1CLK;
+
+    if ((sim_regs.port[2].sel1 & (BIT6 | BIT7)) == (BIT6 | BIT7) && requested)
+    {
+        if (!xt1_enabled)
+        {
+            xt1_enabled = 1;
+            xt1_stable_at = (cfg->xt1_start_ms < 0) ? SIM_NEVER :
+                            sim_stats.now + (uint64_t)(cfg->xt1_start_ms * SIM_ACLK_HZ / 1000.0);
+        }
+    }
+    else
+    {
+        xt1_enabled = 0;
+    }
+
+    if (!xt1_enabled || sim_stats.now < xt1_stable_at)
+    {
+        sim_regs.csctl[7] |= XT1OFFG;
+    }
+    else if (sim_stats.xt1_stable_tick == SIM_NEVER)
+    {
+        sim_stats.xt1_stable_tick = sim_stats.now;
+    }
+    if (sim_regs.csctl[7] & (XT1OFFG | DCOFFG))
+    {
+        sim_regs.sfrifg1 |= OFIFG;
+    }
+    if (sim_stats.aclk_xt1_tick == SIM_NEVER && sim_stats.xt1_stable_tick != SIM_NEVER &&
+        (sim_regs.csctl[4] & SELA) == SELA__XT1CLK)
+    {
+        sim_stats.aclk_xt1_tick = sim_stats.now;
+    }
+}
+
+/* -------------------------------------
+//      Timer_B
+----------------------------------------*/
+static uint8_t timer_running(const SimTimerRegs *t)
+{
+    return ((t->ctl & MC) != MC__STOP) && ((t->ctl & TBSSEL) == TBSSEL__ACLK);
+}
+
+static uint32_t timer_divider(const SimTimerRegs *t)
+{
+    return (1u << ((t->ctl & ID) >> 6)) * ((t->ex0 & TBIDEX) + 1u);
+}
+
+static uint32_t timer_period(const SimTimerRegs *t)
+{
+    // up/down is modelled as up mode; the firmware does not use it
+    return ((t->ctl & MC) == MC__CONTINUOUS) ? 0x10000u : (uint32_t)t->ccr[0] + 1u;
+}
+
+/**
+ * @brief ACLK ticks until the timer counter next reaches a compare value or rolls over.
+ */
+static uint64_t timer_next_event(uint8_t n)
+{
+    const SimTimerRegs *t = &sim_regs.tb[n];
+    if (!timer_running(t))
+    {
+        return SIM_NO_EVENT;
+    }
+
+    uint32_t period = timer_period(t);
+    uint32_t r = t->r;
+    uint32_t counts;
+
+    if (r >= period)
+    {
+        // CCR0 was lowered below the count; the timer rolls to zero
+        counts = 1;
+    }
+    else
+    {
+        counts = period - r; // roll over to zero
+        uint8_t i;
+        for (i = 0; i < timer_ccr_count[n]; i++)
+        {
+            uint32_t target = t->ccr[i];
+            if (target < period && target != r)
+            {
+                uint32_t d = (target > r) ? target - r : period - r + target;
+                if (d < counts)
+                {
+                    counts = d;
+                }
+            }
+        }
+    }
+
+    uint32_t div = timer_divider(t);
+    return (uint64_t)(counts - 1u) * div + (div - timer_prescale[n]);
+}
+
+/**
+ * @brief Advance one timer by a number of ACLK ticks that never skips past an event.
+ */
+static void timer_step(uint8_t n, uint64_t ticks)
+{
+    SimTimerRegs *t = &sim_regs.tb[n];
+    if (!timer_running(t))
+    {
+        return;
+    }
+
+    uint32_t div = timer_divider(t);
+    uint64_t total = timer_prescale[n] + ticks;
+    uint32_t counts = (uint32_t)(total / div);
+    timer_prescale[n] = (uint32_t)(total % div);
+    if (counts == 0)
+    {
+        return;
+    }
+
+    uint32_t period = timer_period(t);
+    uint32_t r = t->r;
+    uint8_t wrapped = 0;
+    if (r >= period)
+    {
+        r = 0;
+        counts -= 1;
+        wrapped = 1;
+    }
+    r += counts;
+    if (r >= period)
+    {
+        r -= period;
+        wrapped = 1;
+    }
+    t->r = (uint16_t)r;
+
+    if (wrapped && r == 0)
+    {
+        t->ctl |= TBIFG;
+    }
+    uint8_t i;
+    for (i = 0; i < timer_ccr_count[n]; i++)
+    {
+        if (t->ccr[i] == r)
+        {
+            t->cctl[i] |= CCIFG;
+        }
+    }
+
+    // output modes 4 (toggle) and 7 (reset/set); mode 0 follows the OUT bit and the other modes are not used
+    for (i = 1; i < timer_ccr_count[n]; i++)
+    {
+        if ((t->cctl[i] & OUTMOD) == OUTMOD_4 && t->ccr[i] == r)
+        {
+            timer_out[n][i] ^= 1;
+            if (n == 1 && timer_out[n][i])
+            {
+                tb1_rising |= 1u << i;      // TB1.1B and TB1.2B are ADC triggers
+            }
+        }
+        if ((t->cctl[i] & OUTMOD) == OUTMOD_7)
+        {
+            if (t->ccr[i] == r)
+            {
+                timer_out[n][i] = 0;
+            }
+            if (t->ccr[0] == r)
+            {
+                timer_out[n][i] = 1;
+            }
+        }
+    }
+}
+
+uint16_t sim_read_tbiv(uint8_t n)
+{
+    sim_sync();
+    SimTimerRegs *t = &sim_regs.tb[n];
+    uint8_t i;
+    for (i = 1; i < timer_ccr_count[n]; i++)
+    {
+        if ((t->cctl[i] & CCIFG) && (t->cctl[i] & CCIE))
+        {
+            t->cctl[i] &= ~CCIFG;
+            return (uint16_t)(i * 2u);
+        }
+    }
+    if ((t->ctl & TBIFG) && (t->ctl & TBIE))
+    {
+        t->ctl &= ~TBIFG;
+        return TBIV__TBIFG;
+    }
+    return TBIV__NONE;
+}
+
+/* -------------------------------------
+//      ADC
+----------------------------------------*/
+static double discharge_mv(uint16_t start_mv, uint16_t end_mv)
+{
+    if (!end_mv || !end_ticks)
+    {
+        return start_mv;
+    }
+    // synthetic discharge curve
+    return start_mv + ((double)end_mv - start_mv) * sim_stats.now / end_ticks;
+}
+
+static uint16_t adc_sample(void)
+{
+    uint16_t ch = sim_regs.adcmctl0 & ADCINCH;
+    double vin_mv = 0;
+    double dvcc_mv = discharge_mv(cfg->dvcc_mv, cfg->dvcc_end_mv);
+    double vref_mv = dvcc_mv;
+
+    if (ch == ADCINCH_1)
+    {
+        vin_mv = discharge_mv(cfg->vbat_mv, cfg->vbat_end_mv);
+    }
+    else if (ch == ADCINCH_13 && (sim_regs.pmmctl2 & INTREFEN))
+    {
+        vin_mv = 1500;
+    }
+    else if (ch == ADCINCH_15)
+    {
+        vin_mv = dvcc_mv;
+    }
+    if ((sim_regs.adcmctl0 & ADCSREF) == ADCSREF_1)
+    {
+        vref_mv = 1500;
+    }
+
+    uint16_t res = sim_regs.adcctl2 & ADCRES;
+    uint32_t full = (res == ADCRES_2) ? 4095u : (res == ADCRES_1) ? 1023u : 255u;
+    double code = vin_mv / vref_mv * (full + 1);
+    return (code >= full) ? (uint16_t)full : (uint16_t)code;
+}
+
+static void adc_update(void)
+{
+    const uint16_t enabled = ADCON | ADCENC;
+    uint16_t shs = sim_regs.adcctl1 & ADCSHS;
+    uint8_t trigger;
+
+    // ADCSC, or a rising TB1.1B/TB1.2B with ADCSHS_2/3; the RTC trigger is not modelled. A timer trigger starts a
+    // conversion whenever the ADC is enabled, as in the repeat modes.
+    if (shs == ADCSHS_0)
+    {
+        trigger = (sim_regs.adcctl0 & ADCSC) != 0;
+    }
+    else
+    {
+        trigger = (shs == ADCSHS_2 && (tb1_rising & BIT1)) || (shs == ADCSHS_3 && (tb1_rising & BIT2));
+    }
+    tb1_rising = 0;
+    if (!adc_busy && trigger && (sim_regs.adcctl0 & enabled) == enabled)
+    {
+        // sample for ADCSHT, then 10, 12 or 14 MODOSC cycles to convert, by ADCRES
+        static const uint16_t sample_clks[16] = {
+            4, 8, 16, 32, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1024, 1024, 1024
+        };
+        uint32_t clks = sample_clks[(sim_regs.adcctl0 & ADCSHT) >> 8] + 10u + ((sim_regs.adcctl2 & ADCRES) >> 3);
+        uint64_t ticks = ((uint64_t)clks * SIM_ACLK_HZ + SIM_MODOSC_HZ - 1) / SIM_MODOSC_HZ;
+
+        adc_busy = 1;
+        adc_done_at = sim_stats.now + ticks;
+        sim_stats.load_uc[SIM_LOAD_ADC] += SIM_Q_ADC_CONVERSION_NC * 1e-3 * clks / (16 + 12);
+        sim_regs.adcctl0 &= ~ADCSC;
+        sim_regs.adcctl1 |= ADCBUSY;
+    }
+}
+
+static void adc_complete(void)
+{
+    adc_busy = 0;
+    sim_regs.adcctl1 &= ~ADCBUSY;
+    if (sim_regs.adcifg & ADCIFG0)
+    {
+        sim_regs.adcifg |= ADCOVIFG;
+    }
+    sim_regs.adcmem0 = adc_sample();
+    sim_stats.adc_conversions++;
+    adc_inside = 0;
+    // window comparator, on every conversion (unsigned results)
+    if (sim_regs.adcmem0 > sim_regs.adchi)
+    {
+        sim_regs.adcifg |= ADCHIIFG;
+    }
+    else if (sim_regs.adcmem0 < sim_regs.adclo)
+    {
+        sim_regs.adcifg |= ADCLOIFG;
+    }
+    else
+    {
+        sim_regs.adcifg |= ADCINIFG;
+        adc_inside = 1;
+    }
+    sim_regs.adcifg |= ADCIFG0;
+}
+
+uint16_t sim_read_adciv(void)
+{
+    static const uint16_t order[6][2] = {
+        {ADCOVIFG, ADCIV_ADCOVIFG}, {ADCTOVIFG, ADCIV_ADCTOVIFG}, {ADCHIIFG, ADCIV_ADCHIIFG},
+        {ADCLOIFG, ADCIV_ADCLOIFG}, {ADCINIFG, ADCIV_ADCINIFG}, {ADCIFG0, ADCIV_ADCIFG}
+    };
+    sim_sync();
+    uint8_t i;
+    for (i = 0; i < 6; i++)
+    {
+        if (sim_regs.adcifg & sim_regs.adcie & order[i][0])
+        {
+            sim_regs.adcifg &= ~order[i][0];
+            return order[i][1];
+        }
+    }
+    return ADCIV_NONE;
+}
+
+/* -------------------------------------
+//      eCOMP1
+----------------------------------------*/
+static double comp_input(uint16_t sel)
+{
+    if (sel == CPPSEL_6)
+    {
+        // 6-bit DAC, buffer 1, in DAC steps
+        return (sim_regs.cp1dacctl & CPDACEN) ? (double)(sim_regs.cp1dacdata & 0x3F) : 0.0;
+    }
+    // every other input is the wire link from the photodiode amplifier (OA2O)
+    return cfg->light_level;
+}
+
+static void comp_update(void)
+{
+    uint8_t out = 0;
+    if (sim_regs.cp1ctl1 & CPEN)
+    {
+        double plus = comp_input(sim_regs.cp1ctl0 & CPPSEL);
+        double minus = comp_input((sim_regs.cp1ctl0 & CPNSEL) >> 8);
+        out = plus > minus;
+        if (sim_regs.cp1ctl1 & CPINV)
+        {
+            out = !out;
+        }
+    }
+    if (out != comp_out)
+    {
+        sim_regs.cp1int |= out ? CPIFG : CPIIFG;
+        comp_out = out;
+    }
+    sim_regs.cp1ctl1 = (sim_regs.cp1ctl1 & ~CPOUT) | out;
+}
+
+uint16_t sim_read_cpiv(void)
+{
+    sim_sync();
+    if ((sim_regs.cp1int & CPIFG) && (sim_regs.cp1ctl1 & CPIE))
+    {
+        sim_regs.cp1int &= ~CPIFG;
+        return CPIV__CPIFG;
+    }
+    if ((sim_regs.cp1int & CPIIFG) && (sim_regs.cp1ctl1 & CPIIE))
+    {
+        sim_regs.cp1int &= ~CPIIFG;
+        return CPIV__CPIIFG;
+    }
+    return CPIV__NONE;
+}
+
+/* -------------------------------------
+//      digital I/O
+----------------------------------------*/
+uint8_t sim_pin_level(uint8_t port, uint8_t mask)
+{
+    const SimPortRegs *p = &sim_regs.port[port];
+    if ((p->sel0 | p->sel1) & mask)
+    {
+        // module function: only Timer_B outputs are modelled
+        uint8_t i;
+        for (i = 0; i < sizeof(timer_pins) / sizeof(timer_pins[0]); i++)
+        {
+            if (timer_pins[i].port == port && timer_pins[i].mask == mask)
+            {
+                return (p->dir & mask) ? timer_out[timer_pins[i].timer][timer_pins[i].ccr] : 0;
+            }
+        }
+        return 0;
+    }
+    return (p->dir & p->out & mask) ? 1 : 0;
+}
+
+uint8_t sim_port_in(uint8_t port)
+{
+    sim_sync();
+    const SimPortRegs *p = &sim_regs.port[port];
+    uint8_t in = (p->out & p->dir) | (p->out & p->ren & ~p->dir);
+    if (port == 4 && switch_pressed)
+    {
+        in &= ~BIT1; // SW1 shorts P4.1 to ground
+    }
+    return in;
+}
+
+static void switch_edge(uint8_t pressed)
+{
+    SimPortRegs *p = &sim_regs.port[4];
+    switch_pressed = pressed;
+    // a press is a high-to-low edge, which P4IES = 1 selects
+    if (((p->ies & BIT1) != 0) == (pressed != 0))
+    {
+        p->ifg |= BIT1;
+    }
+}
+
+/* -------------------------------------
+//      supply current
+----------------------------------------*/
+/**
+ * @brief Charge the LEDs and analog peripherals for an interval in which no register or pin changes.
+ * @param ticks Length of the interval in ACLK ticks.
+ * @note The CPU is charged separately, by charge_time() and sim_sleep(). ADC conversions are charged as they start.
+ */
+static void charge_loads(uint64_t ticks)
+{
+    double s = sim_ticks_to_s(ticks);
+    double led_ma = 0;
+    uint8_t i;
+
+    for (i = 0; i < sim_pin_count; i++)
+    {
+        if (sim_pins[i].load_ma > 0 && sim_pin_level(sim_pins[i].port, sim_pins[i].mask))
+        {
+            led_ma += sim_pins[i].load_ma;
+        }
+    }
+    sim_stats.load_uc[SIM_LOAD_LEDS] += 1e3 * led_ma * s;
+
+    if (sim_regs.pmmctl2 & INTREFEN)
+    {
+        sim_stats.load_uc[SIM_LOAD_REF] += SIM_I_REF_UA * s;
+    }
+    if (sim_regs.cp1ctl1 & CPEN)
+    {
+        sim_stats.load_uc[SIM_LOAD_ECOMP] += ((sim_regs.cp1ctl1 & CPMSEL) ? SIM_I_ECOMP_LP_UA : SIM_I_ECOMP_UA) * s;
+    }
+    if ((sim_regs.sac2oa & (OAEN | SACEN)) == (OAEN | SACEN))
+    {
+        sim_stats.load_uc[SIM_LOAD_SAC] += ((sim_regs.sac2oa & OAPM) ? SIM_I_SAC_LP_UA : SIM_I_SAC_UA) * s;
+    }
+
+    // REFO runs while it is ACLK - selected, or standing in for a faulting XT1 - or the reference of a running FLL
+    uint16_t sela = sim_regs.csctl[4] & SELA;
+    if (sela == SELA__REFOCLK || (sela == SELA__XT1CLK && (sim_regs.csctl[7] & XT1OFFG)) ||
+        (!(sr & SCG0) && (sim_regs.csctl[3] & SELREF) == SELREF__REFOCLK))
+    {
+        sim_stats.load_uc[SIM_LOAD_REFO] += SIM_I_REFO_UA * s;
+    }
+}
+
+static uint64_t ms_to_ticks(double ms)
+{
+    return (uint64_t)(ms * SIM_ACLK_HZ / 1000.0);
+}
+
+/* -------------------------------------
+//      time base
+----------------------------------------*/
+static uint64_t next_event(void)
+{
+    uint64_t d = SIM_NO_EVENT;
+    uint8_t n;
+    for (n = 0; n < SIM_TIMER_COUNT; n++)
+    {
+        uint64_t t = timer_next_event(n);
+        if (t < d) d = t;
+    }
+    if (adc_busy && adc_done_at - sim_stats.now < d)
+    {
+        d = adc_done_at - sim_stats.now;
+    }
+    if (next_press < cfg->press_count)
+    {
+        uint64_t at = ms_to_ticks(cfg->presses_ms[next_press]);
+        uint64_t t = (at > sim_stats.now) ? at - sim_stats.now : 1;
+        if (t < d) d = t;
+    }
+    if (switch_pressed && switch_release_at - sim_stats.now < d)
+    {
+        d = switch_release_at - sim_stats.now;
+    }
+    if (bounce_left)
+    {
+        d = 1;
+    }
+    return d;
+}
+
+static void advance(uint64_t ticks)
+{
+    while (ticks)
+    {
+        uint64_t step = next_event();
+        if (step > ticks)
+        {
+            step = ticks;
+        }
+        charge_loads(step);
+        uint8_t n;
+        for (n = 0; n < SIM_TIMER_COUNT; n++)
+        {
+            timer_step(n, step);
+        }
+        sim_stats.now += step;
+        ticks -= step;
+        adc_update();   // a timer-triggered conversion
+
+        if (adc_busy && sim_stats.now >= adc_done_at)
+        {
+            adc_complete();
+        }
+        if (bounce_left)
+        {
+            // the contact opens and closes again within the tick: one more press edge
+            bounce_left--;
+            switch_edge(0);
+            switch_edge(1);
+        }
+        if (switch_pressed && sim_stats.now >= switch_release_at)
+        {
+            switch_edge(0);
+        }
+        if (next_press < cfg->press_count && sim_stats.now >= ms_to_ticks(cfg->presses_ms[next_press]))
+        {
+            next_press++;
+            switch_release_at = sim_stats.now + ms_to_ticks(SIM_SWITCH_RELEASE_MS);
+            bounce_left = cfg->bounce;
+            switch_edge(1);
+        }
+        sim_trace_pins(sim_stats.now);
+    }
+}
+
+/**
+ * @brief Apply the side effects of register writes that take effect immediately.
+ */
+static void update_peripherals(void)
+{
+    uint8_t n;
+    clock_update();
+    for (n = 0; n < SIM_TIMER_COUNT; n++)
+    {
+        if (sim_regs.tb[n].ctl & TBCLR)
+        {
+            sim_regs.tb[n].ctl &= ~TBCLR;
+            sim_regs.tb[n].r = 0;
+            timer_prescale[n] = 0;
+        }
+        uint8_t i;
+        for (i = 1; i < timer_ccr_count[n]; i++)
+        {
+            if ((sim_regs.tb[n].cctl[i] & OUTMOD) == OUTMOD_0)
+            {
+                timer_out[n][i] = (sim_regs.tb[n].cctl[i] & OUT) ? 1 : 0;
+            }
+        }
+    }
+
+    if (sim_regs.pmmctl2 & INTREFEN)
+    {
+        sim_regs.pmmctl2 |= REFGENRDY | REFBGRDY;
+    }
+    else
+    {
+        sim_regs.pmmctl2 &= ~(REFGENRDY | REFBGRDY);
+    }
+
+    adc_update();
+    comp_update();
+    sim_trace_pins(sim_stats.now);
+}
+
+/* -------------------------------------
+//      interrupts and low-power modes
+----------------------------------------*/
+static int pending_source(void)
+{
+    uint8_t n;
+    for (n = 0; n < SIM_TIMER_COUNT; n++)
+    {
+        const SimTimerRegs *t = &sim_regs.tb[n];
+        if ((t->cctl[0] & CCIFG) && (t->cctl[0] & CCIE))
+        {
+            return SIM_SRC_TIMER0_B0 + 2 * n;
+        }
+        uint8_t i;
+        uint8_t b1 = (t->ctl & TBIFG) && (t->ctl & TBIE);
+        for (i = 1; i < timer_ccr_count[n]; i++)
+        {
+            b1 |= (t->cctl[i] & CCIFG) && (t->cctl[i] & CCIE);
+        }
+        if (b1)
+        {
+            return SIM_SRC_TIMER0_B1 + 2 * n;
+        }
+    }
+    if (sim_regs.adcifg & sim_regs.adcie)
+    {
+        return SIM_SRC_ADC;
+    }
+    if (((sim_regs.cp1int & CPIFG) && (sim_regs.cp1ctl1 & CPIE)) ||
+        ((sim_regs.cp1int & CPIIFG) && (sim_regs.cp1ctl1 & CPIIE)))
+    {
+        return SIM_SRC_ECOMP;
+    }
+    if (sim_regs.port[4].ifg & sim_regs.port[4].ie)
+    {
+        return SIM_SRC_PORT4;
+    }
+    return -1;
+}
+
+static void dispatch(int src)
+{
+    if (isr_table[src] == NULL)
+    {
+        fprintf(stderr, "sim: %s interrupt enabled but the firmware has no handler\n", sim_source_names[src]);
+        exit(EXIT_FAILURE);
+    }
+    if (!awake)
+    {
+        wake_begin();
+    }
+    wake_sources |= 1u << src;
+    sim_stats.isr_calls[src]++;
+    if (src == SIM_SRC_ADC && adc_inside)
+    {
+        sim_stats.adc_inside_isr_calls++;
+    }
+    extra_cycles += SIM_ISR_OVERHEAD_CYCLES;
+
+    if (src <= SIM_SRC_TIMER3_B1 && (src % 2) == 0)
+    {
+        // single-source CCR0 vectors clear their flag when serviced
+        sim_regs.tb[src / 2].cctl[0] &= ~CCIFG;
+    }
+
+    uint16_t saved = sr;
+    uint16_t *outer = isr_sr;
+    isr_sr = &saved;
+    sr &= SCG0;
+    isr_table[src]();
+    isr_sr = outer;
+    sr = saved;
+}
+
+static void service_interrupts(void)
+{
+    while ((sr & GIE) && isr_sr == NULL)
+    {
+        int src = pending_source();
+        if (src < 0)
+        {
+            return;
+        }
+        dispatch(src);
+        if (sr & CPUOFF)
+        {
+            return; // the sleep loop takes it from here
+        }
+    }
+}
+
+static void sim_sync(void)
+{
+    charge_time();
+    if (sim_stats.now > end_ticks + SIM_ACLK_HZ)
+    {
+        fprintf(stderr, "sim: firmware has not entered LPM for a second of simulated time\n");
+        longjmp(exit_jmp, 1);
+    }
+    update_peripherals();
+    if (!(sr & CPUOFF))
+    {
+        service_interrupts();
+    }
+}
+
+static void sim_sleep(void)
+{
+    wake_end();
+    while (sr & CPUOFF)
+    {
+        if (sim_stats.now >= end_ticks)
+        {
+            longjmp(exit_jmp, 1);
+        }
+        int src = (sr & GIE) ? pending_source() : -1;
+        if (src >= 0)
+        {
+            dispatch(src);
+            if (sr & CPUOFF)
+            {
+                wake_end(); // handled entirely within the ISR
+            }
+            continue;
+        }
+        uint64_t d = next_event();
+        if (d > end_ticks - sim_stats.now)
+        {
+            d = end_ticks - sim_stats.now;
+        }
+        if ((sr & LPM3_bits) == LPM3_bits)
+        {
+            sim_stats.lpm3_ticks += d;
+            sim_stats.sleep_uc += SIM_I_LPM3_UA * sim_ticks_to_s(d);
+            if (adc_busy)
+            {
+                sim_stats.lpm3_adc_ticks += d;
+            }
+        }
+        else
+        {
+            sim_stats.sleep_uc += (SIM_I_LPM0_UA + SIM_I_LPM0_DCO_UA_PER_MHZ * sim_dco_hz() / 1e6) * sim_ticks_to_s(d);
+        }
+        advance(d);
+    }
+}
+
+/**
+ * @brief Count FRAM code running faster than FRAM can be read with the current wait states.
+ * @note Checked as each block starts and at each register access, so a clock change that is undone a few
+ *       instructions later, within one block, is still seen at the next register write.
+ */
+static void check_fram_speed(void)
+{
+    if (in_fram && !(sim_regs.frctl0 & NWAITS) && sim_mclk_hz() > SIM_FRAM_MAX_HZ_NO_WAIT)
+    {
+        sim_stats.fram_overspeed++;
+    }
+}
+
+volatile uint8_t *sim_reg8(uint8_t *reg)
+{
+    sim_sync();
+    check_fram_speed();
+    sync_pending = 1;
+    return reg;
+}
+
+volatile uint16_t *sim_reg16(uint16_t *reg)
+{
+    sim_sync();
+    check_fram_speed();
+    sync_pending = 1;
+    return reg;
+}
+
+void sim_bis_sr(uint16_t bits)
+{
+    sim_sync();
+    sr |= bits;
+    if (isr_sr == NULL && (sr & CPUOFF))
+    {
+        sim_sleep();
+    }
+    else
+    {
+        service_interrupts();
+    }
+}
+
+void sim_bic_sr(uint16_t bits)
+{
+    sim_sync();
+    sr &= ~bits;
+}
+
+void sim_bis_sr_on_exit(uint16_t bits)
+{
+    if (isr_sr)
+    {
+        *isr_sr |= bits;
+    }
+}
+
+void sim_bic_sr_on_exit(uint16_t bits)
+{
+    if (isr_sr)
+    {
+        *isr_sr &= ~bits;
+    }
+}
+
+uint16_t sim_get_sr(void)
+{
+    return sr;
+}
+
+void sim_delay_cycles(uint32_t cycles)
+{
+    extra_cycles += cycles;
+    sim_sync();
+}
+
+/* -------------------------------------
+//      run control
+----------------------------------------*/
+void sim_add_pin(const char *name, uint8_t port, uint8_t mask, double load_ma)
+{
+    if (sim_pin_count < SIM_MAX_PINS)
+    {
+        sim_pins[sim_pin_count].name = name;
+        sim_pins[sim_pin_count].port = port;
+        sim_pins[sim_pin_count].mask = mask;
+        sim_pins[sim_pin_count].load_ma = load_ma;
+        sim_pin_count++;
+    }
+}
+
+void sim_reset(const SimConfig *config)
+{
+    cfg = config;
+    memset(&sim_regs, 0, sizeof(sim_regs));
+    memset(&sim_stats, 0, sizeof(sim_stats));
+    memset(timer_prescale, 0, sizeof(timer_prescale));
+    memset(timer_out, 0, sizeof(timer_out));
+    sim_stats.xt1_stable_tick = SIM_NEVER;
+    sim_stats.aclk_xt1_tick = SIM_NEVER;
+    uint8_t i;
+    for (i = 0; i < SIM_MAX_PINS; i++)
+    {
+        sim_stats.pins[i].first_edge = SIM_NEVER;
+    }
+
+    // power-on values the firmware depends on
+    sim_regs.pm5ctl0 = LOCKLPM5;
+    sim_regs.syscfg0 = PFWP | DFWP;
+    sim_regs.sfrifg1 = OFIFG;
+    sim_regs.csctl[1] = DCOFTRIM_3 | DCORSEL_1;
+    sim_regs.csctl[2] = FLLD_1 | 31;   // DCOCLKDIV ~1 MHz
+    sim_regs.csctl[6] = XT1DRIVE_3 | XT1AUTOOFF;
+    sim_regs.csctl[7] = XT1OFFG | DCOFFG;
+    sim_regs.adcctl2 = ADCRES_1;
+    sim_regs.adchi = 0x3FF;
+
+    end_ticks = (uint64_t)(cfg->seconds * SIM_ACLK_HZ);
+    sr = 0;
+    isr_sr = NULL;
+    blocks = 0;
+    insns = 0;
+    wait_insns = 0;
+    synced_ram_insns = 0;
+    extra_cycles = 0;
+    synced_cycles = 0;
+    tick_frac = 0;
+    sync_pending = 0;
+    in_fram = 1;
+    awake = 1; // out of reset the CPU is running
+    wake_start_tick = 0;
+    wake_start_blocks = 0;
+    wake_start_insns = 0;
+    wake_start_cycles = 0;
+    wake_sources = 0;
+    adc_busy = 0;
+    adc_inside = 0;
+    tb1_rising = 0;
+    comp_out = 0;
+    switch_pressed = 0;
+    next_press = 0;
+    bounce_left = 0;
+    xt1_enabled = 0;
+    xt1_stable_at = SIM_NEVER;
+}
+
+void sim_run(void (*entry)(void))
+{
+    sim_trace_begin(cfg);
+    if (setjmp(exit_jmp) == 0)
+    {
+        entry();
+        fprintf(stderr, "sim: firmware entry returned\n");
+    }
+    wake_end();
+    sim_trace_end(sim_stats.now);
+}
@@ -0,0 +1,245 @@
+/**
+ * @file sim.h
+ * @brief Simulated MSP430FR2355 core: time base, peripherals, interrupts and cost accounting.
+ * @ingroup HOST_SIM
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <setjmp.h>
+#include "msp430fr2355.h"
+
+/** @addtogroup HOST_SIM
+ * @{
+ */
+
+#define SIM_ACLK_HZ             32768u  // XT1 / REFO, the simulated time base
+#define SIM_MAX_PINS            16
+#define SIM_MAX_PRESSES         16
+#define SIM_DEFAULT_BLOCK_INSNS 4       // per-block estimate when no cost file is loaded
+#define SIM_NEVER               UINT64_MAX  // time stamp of something that did not happen
+
+// CPU supply current model, rough typical figures for the MSP430FR2355 at 3 V. A cycle's charge in pC is the
+// datasheet's uA/MHz figure; the part of active current that does not scale with MCLK is charged per second awake.
+#define SIM_FRAM_MISSES_PER_INSN    0.3     // FRAM cache misses per instruction run from FRAM, each NWAITS cycles
+#define SIM_FRAM_MAX_HZ_NO_WAIT     8000000u // fastest MCLK for FRAM with NWAITS_0
+#define SIM_I_ACTIVE_UA             60.0    // active mode, independent of MCLK: regulator, clock system
+#define SIM_Q_FRAM_CYCLE_PC         120.0   // per MCLK cycle running from FRAM
+#define SIM_Q_RAM_CYCLE_PC          80.0    // per MCLK cycle running from RAM
+#define SIM_I_LPM0_UA               60.0    // LPM0, plus the DCO below
+#define SIM_I_LPM0_DCO_UA_PER_MHZ   6.0     // LPM0 with the DCO and FLL running, per MHz of DCOCLKDIV
+#define SIM_I_LPM3_UA               1.2     // LPM3 with a 32 kHz ACLK from XT1, RAM retained
+
+// Supply current of the LEDs and analog peripherals, drawn in every mode while their enable bits are set; rough
+// typical figures at 3 V like the CPU model above. The LED current is set by each LED's series resistor.
+#define SIM_LED_MA                  2.0     // default forward current of an LED while its pin is high
+#define SIM_BATTERY_MAH             220.0   // default cell capacity for the battery life estimate, a CR2032
+#define SIM_Q_ADC_CONVERSION_NC     1.2     // one 10-bit conversion: about 175 uA for 16 + 12 MODOSC cycles
+#define SIM_MODOSC_HZ               3800000u // ADC clock; the charge above scales with the sample time
+#define SIM_I_REF_UA                15.0    // internal shared reference (INTREFEN)
+#define SIM_I_ECOMP_UA              24.0    // eCOMP in high-speed mode (CPEN)
+#define SIM_I_ECOMP_LP_UA           1.6     // eCOMP in low-power mode (CPEN | CPMSEL)
+#define SIM_I_SAC_UA                350.0   // SAC op-amp in high-speed mode (OAEN | SACEN)
+#define SIM_I_SAC_LP_UA             120.0   // SAC op-amp in low-power mode (OAPM)
+#define SIM_I_REFO_UA               15.0    // REFO, when it sources ACLK or a running FLL; XT1 is in SIM_I_LPM3_UA
+
+/** Interrupt sources the simulator can dispatch, in descending hardware priority. */
+typedef enum
+{
+    SIM_SRC_TIMER0_B0 = 0,
+    SIM_SRC_TIMER0_B1,
+    SIM_SRC_TIMER1_B0,
+    SIM_SRC_TIMER1_B1,
+    SIM_SRC_TIMER2_B0,
+    SIM_SRC_TIMER2_B1,
+    SIM_SRC_TIMER3_B0,
+    SIM_SRC_TIMER3_B1,
+    SIM_SRC_ADC,
+    SIM_SRC_ECOMP,
+    SIM_SRC_PORT4,
+    SIM_SRC_COUNT
+} SimSource;
+
+/** Supply current draws other than the CPU, charged separately in SimStats.load_uc. */
+typedef enum
+{
+    SIM_LOAD_LEDS = 0,
+    SIM_LOAD_ADC,
+    SIM_LOAD_REF,
+    SIM_LOAD_ECOMP,
+    SIM_LOAD_SAC,
+    SIM_LOAD_REFO,
+    SIM_LOAD_COUNT
+} SimLoad;
+
+/** A pin recorded in the PWM trace. */
+typedef struct
+{
+    const char *name;
+    uint8_t port;
+    uint8_t mask;
+    double load_ma;                 // current drawn from the supply while the pin is high, 0 for a debug pin
+} SimPin;
+
+/** Simulation settings, filled in by the harness before sim_reset(). */
+typedef struct
+{
+    double seconds;                 // simulated run time
+    double cycles_per_insn;         // MCLK cycles charged per estimated MSP430 instruction
+    double light_level;             // photodiode front-end output in comparator DAC steps (0-63)
+    uint16_t vbat_mv;               // voltage on the VBAT sense pin
+    uint16_t vbat_end_mv;           // VBAT at the end of the run, falling linearly from vbat_mv; 0 = constant
+    uint16_t dvcc_mv;               // supply voltage, the ADC reference with ADCSREF_0
+    uint16_t dvcc_end_mv;           // DVCC at the end of the run, falling linearly from dvcc_mv; 0 = constant
+    double battery_mah;             // cell capacity for the battery life estimate
+    double xt1_start_ms;            // XT1 start-up time from when its pins are selected; negative = never starts
+    double presses_ms[SIM_MAX_PRESSES]; // switch press times
+    uint8_t press_count;
+    uint16_t bounce;                // extra press edges after each press, one every ACLK tick, as a bouncing contact
+    double trace_from;              // trace window start (s)
+    double trace_to;                // trace window end (s), 0 = end of run
+    FILE *vcd;                      // per-pin PWM trace (VCD), may be NULL
+    FILE *ticks;                    // per-wakeup cost records (CSV), may be NULL
+} SimConfig;
+
+/** Cost counters: everything the firmware has run since sim_reset(). */
+typedef struct
+{
+    uint64_t blocks;
+    uint64_t insns;
+    uint64_t cycles;                // MCLK cycles, including FRAM wait states, delays and interrupt entry
+} SimCost;
+
+/** Cost statistics for one class of wakeup. */
+typedef struct
+{
+    uint64_t count;
+    uint64_t blocks_total;
+    uint64_t insns_total;
+    uint64_t insns_min;
+    uint64_t insns_max;
+    uint64_t cycles_total;
+    uint64_t cycles_min;
+    uint64_t cycles_max;
+} SimCostStats;
+
+/** Per-pin output statistics. */
+typedef struct
+{
+    uint64_t high_ticks;
+    uint64_t edges;
+    uint64_t first_edge;            // simulated time of the first edge, SIM_NEVER if there was none
+} SimPinStats;
+
+/** Totals collected over a run. */
+typedef struct
+{
+    uint64_t now;                   // simulated time in ACLK ticks
+    uint64_t wakeups;
+    uint64_t isr_calls[SIM_SRC_COUNT];
+    uint64_t active_cycles;         // MCLK cycles spent out of LPM
+    uint64_t active_ticks;          // ACLK ticks spent out of LPM
+    uint64_t lpm3_ticks;            // ACLK ticks spent in LPM3 or deeper (SCG1 and SCG0 set, SMCLK and DCO off)
+    uint64_t lpm3_adc_ticks;        // ACLK ticks spent in LPM3 with an ADC conversion in flight
+    uint64_t adc_conversions;
+    uint64_t adc_inside_isr_calls;  // ADC interrupts taken while the latest conversion was inside [ADCLO, ADCHI]
+    uint64_t ram_insns;             // instructions run from RAMFUNC code
+    uint64_t fram_overspeed;        // blocks entered or registers accessed from FRAM code above SIM_FRAM_MAX_HZ_NO_WAIT
+                                    // with no wait state
+    double active_uc;               // CPU charge drawn while awake, uC
+    double sleep_uc;                // CPU charge drawn in LPM, uC
+    double load_uc[SIM_LOAD_COUNT]; // charge drawn by the LEDs and peripherals, uC
+    uint64_t xt1_stable_tick;       // when XT1 stopped reporting a fault, SIM_NEVER if it did not
+    uint64_t aclk_xt1_tick;         // when ACLK was first switched to a stable XT1, SIM_NEVER if it was not
+    SimCostStats tick;              // wakeups that serviced TIMER0_B0 (the animation tick)
+    SimCostStats all;               // every wakeup
+    SimPinStats pins[SIM_MAX_PINS];
+} SimStats;
+
+extern SimStats sim_stats;
+extern SimPin sim_pins[SIM_MAX_PINS];
+extern uint8_t sim_pin_count;
+extern const char *const sim_source_names[SIM_SRC_COUNT];
+extern const char *const sim_load_names[SIM_LOAD_COUNT];
+
+/**
+ * @brief Reset the register file and peripheral models and apply the run configuration.
+ * @param cfg Settings for this run. The pointer is kept for the whole run.
+ */
+void sim_reset(const SimConfig *cfg);
+
+/**
+ * @brief Load per-block instruction estimates written by block_costs.py.
+ * @param path Cost file path.
+ * @param anchor Run-time address of the anchor symbol named when the file was generated.
+ * @return 1 if loaded. Without a cost file every block counts as SIM_DEFAULT_BLOCK_INSNS instructions.
+ */
+int sim_load_block_costs(const char *path, uintptr_t anchor);
+
+/**
+ * @brief Load the cost file block_costs.py wrote next to the running binary, <binary>.costs.
+ * @param anchor Run-time address of the anchor symbol named when the file was generated.
+ * @return 1 if loaded.
+ */
+int sim_load_own_block_costs(uintptr_t anchor);
+
+/**
+ * @brief Return the cost counters, for measuring a stretch of firmware code as the difference of two readings.
+ * @return Blocks, instructions and MCLK cycles run since sim_reset().
+ */
+SimCost sim_cost(void);
+
+/**
+ * @brief Register a pin for the PWM trace, duty statistics and current model.
+ * @param name Signal name used in the VCD file and the report.
+ * @param port Port number (1-6).
+ * @param mask Bit mask within the port.
+ * @param load_ma Current the pin's load draws while it is high, in mA; 0 for a pin that drives nothing.
+ */
+void sim_add_pin(const char *name, uint8_t port, uint8_t mask, double load_ma);
+
+/**
+ * @brief Run the firmware entry point until the configured simulated time has elapsed.
+ * @param entry Firmware entry, normally a wrapper calling init_earrings() and run_earrings().
+ * @note The firmware never returns; the simulator unwinds it with longjmp() when it next enters LPM after the end time.
+ */
+void sim_run(void (*entry)(void));
+
+/**
+ * @brief Convert ACLK ticks to seconds.
+ * @param ticks Simulated time in ACLK ticks.
+ * @return Seconds.
+ */
+double sim_ticks_to_s(uint64_t ticks);
+
+/**
+ * @brief Return the MCLK frequency implied by the current clock system registers.
+ * @return MCLK in Hz.
+ */
+uint32_t sim_mclk_hz(void);
+
+/**
+ * @brief Return the DCOCLKDIV frequency the FLL is locked to, before the MCLK divider.
+ * @return DCOCLKDIV in Hz.
+ */
+uint32_t sim_dco_hz(void);
+
+/**
+ * @brief Return the simulated logic level of a pin.
+ * @param port Port number (1-6).
+ * @param mask Bit mask within the port.
+ * @return 1 when the pin is driven high.
+ */
+uint8_t sim_pin_level(uint8_t port, uint8_t mask);
+
+/* trace output, sim_trace.c */
+void sim_trace_begin(const SimConfig *cfg);
+void sim_trace_pins(uint64_t now);
+void sim_trace_wake(uint64_t wake, uint64_t start, uint32_t sources, uint64_t blocks, uint64_t insns, uint64_t cycles);
+void sim_trace_end(uint64_t now);
+
+/** @} */
+#endif // SIM_H
@@ -0,0 +1,326 @@
+/**
+ * @file sim_main.c
+ * @brief Command line harness that runs the earrings firmware on the host simulator.
+ * @ingroup HOST_SIM
+ */
+
+#include "sim.h"
+#include "earrings.h"
+#include "drivers/gpio.h"
+#include "tick_stats.h"
+#include "task_scheduler.h"
+#include "battery_governor.h"
+#include "drivers/event_queue.h"
+#include "resume_state.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --seconds S     simulated run time in seconds (default 10)\n"
+        "  --cpi N         MCLK cycles per estimated MSP430 instruction (default 3)\n"
+        "  --light L       photodiode level in comparator DAC steps, 0-63 (default 32)\n"
+        "  --vbat-mv MV    voltage on the VBAT sense pin (default 3000)\n"
+        "  --vbat-end-mv MV  discharge VBAT linearly to MV by the end of the run (default constant)\n"
+        "  --dvcc-mv MV    supply voltage, the ADC reference (default 3300)\n"
+        "  --dvcc-end-mv MV  discharge DVCC linearly to MV by the end of the run (default constant)\n"
+        "  --led-ma MA     forward current of each LED while it is lit (default 2)\n"
+        "  --battery-mah C cell capacity for the battery life estimate (default 220)\n"
+        "  --xt1-ms MS     XT1 crystal start-up time, negative for a crystal that never starts (default 500)\n"
+        "  --press MS      press SW1 at MS milliseconds, repeatable\n"
+        "  --bounce N      SW1 bounces: N more press edges after each press, one per ACLK tick\n"
+        "  --fram FILE     load the firmware's resume state from FILE if it exists, save it there after the run\n"
+        "  --vcd FILE      write per-pin PWM traces as a VCD file\n"
+        "  --ticks FILE    write a per-wakeup cost record CSV\n"
+        "  --from S        start of the trace window in seconds (default 0)\n"
+        "  --to S          end of the trace window in seconds (default end of run)\n",
+        prog);
+    exit(EXIT_FAILURE);
+}
+
+static FILE *open_output(const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+    {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    return f;
+}
+
+/**
+ * @brief Load the firmware's information FRAM resume slots from a file, as if the device had been reset.
+ * @return 1 if the file was there.
+ */
+static int load_fram(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        return 0;
+    }
+    if (fread(resume_slots, sizeof(resume_slots), 1, f) != 1)
+    {
+        memset(resume_slots, 0, sizeof(resume_slots));
+    }
+    fclose(f);
+    return 1;
+}
+
+static void save_fram(const char *path)
+{
+    FILE *f = open_output(path);
+    fwrite(resume_slots, sizeof(resume_slots), 1, f);
+    fclose(f);
+}
+
+static void firmware_entry(void)
+{
+    // same sequence as main() in main.c
+    init_earrings();
+    run_earrings();
+}
+
+static void print_cost(const char *label, const SimCostStats *s)
+{
+    if (s->count == 0)
+    {
+        printf("%-14s none\n", label);
+        return;
+    }
+    printf("%-14s %llu wakeups, blocks mean %.1f, insns min/mean/max %llu/%.1f/%llu, cycles min/mean/max %llu/%.1f/%llu\n",
+           label, (unsigned long long)s->count, (double)s->blocks_total / s->count,
+           (unsigned long long)s->insns_min, (double)s->insns_total / s->count, (unsigned long long)s->insns_max,
+           (unsigned long long)s->cycles_min, (double)s->cycles_total / s->count, (unsigned long long)s->cycles_max);
+}
+
+/**
+ * @brief Format a simulated time stamp in milliseconds, or "never".
+ */
+static const char *format_ms(uint64_t ticks, char *buf, size_t size)
+{
+    if (ticks == SIM_NEVER)
+    {
+        snprintf(buf, size, "never");
+    }
+    else
+    {
+        snprintf(buf, size, "%.1f ms", 1e3 * sim_ticks_to_s(ticks));
+    }
+    return buf;
+}
+
+static void print_report(const SimConfig *cfg)
+{
+    double seconds = sim_ticks_to_s(sim_stats.now);
+    uint8_t i;
+
+    printf("simulated      %.3f s (%llu ACLK ticks), MCLK %.3f MHz\n",
+           seconds, (unsigned long long)sim_stats.now, sim_mclk_hz() / 1e6);
+    printf("interrupts    ");
+    for (i = 0; i < SIM_SRC_COUNT; i++)
+    {
+        if (sim_stats.isr_calls[i])
+        {
+            printf(" %s=%llu", sim_source_names[i], (unsigned long long)sim_stats.isr_calls[i]);
+        }
+    }
+    printf("\n");
+    printf("adc            %llu conversions, %llu interrupts on a conversion inside the window\n",
+           (unsigned long long)sim_stats.adc_conversions, (unsigned long long)sim_stats.adc_inside_isr_calls);
+    print_cost("tick cost", &sim_stats.tick);
+    print_cost("wakeup cost", &sim_stats.all);
+    printf("awake          %llu cycles, %.3f%% of simulated time\n",
+           (unsigned long long)sim_stats.active_cycles,
+           seconds > 0 ? 100.0 * sim_ticks_to_s(sim_stats.active_ticks) / seconds : 0.0);
+    double dvcc_v = cfg->dvcc_mv / 1000.0;    // energy at the starting supply voltage
+    printf("cpu energy     %.1f uA mean, %.1f nJ per animation tick (awake %.1f, asleep %.1f), %.1f%% of instructions from RAM\n",
+           seconds > 0 ? (sim_stats.active_uc + sim_stats.sleep_uc) / seconds : 0.0,
+           sim_stats.tick.count ? 1e3 * (sim_stats.active_uc + sim_stats.sleep_uc) * dvcc_v / sim_stats.tick.count : 0.0,
+           sim_stats.tick.count ? 1e3 * sim_stats.active_uc * dvcc_v / sim_stats.tick.count : 0.0,
+           sim_stats.tick.count ? 1e3 * sim_stats.sleep_uc * dvcc_v / sim_stats.tick.count : 0.0,
+           sim_stats.all.insns_total ? 100.0 * sim_stats.ram_insns / sim_stats.all.insns_total : 0.0);
+    printf("fram           %llu blocks or register accesses in FRAM code above %u MHz with no wait state\n",
+           (unsigned long long)sim_stats.fram_overspeed, SIM_FRAM_MAX_HZ_NO_WAIT / 1000000u);
+    {
+        // mean supply current of each draw; uC per second is uA, and mAh per hour is mA
+        double cpu_uc = sim_stats.active_uc + sim_stats.sleep_uc;
+        double total_uc = cpu_uc;
+        for (i = 0; i < SIM_LOAD_COUNT; i++)
+        {
+            total_uc += sim_stats.load_uc[i];
+        }
+        double mean_ma = seconds > 0 ? 1e-3 * total_uc / seconds : 0.0;
+        printf("current        %.1f uA mean, %.4f mAh per hour: cpu %.1f",
+               1e3 * mean_ma, mean_ma, seconds > 0 ? cpu_uc / seconds : 0.0);
+        for (i = 0; i < SIM_LOAD_COUNT; i++)
+        {
+            printf(", %s %.1f", sim_load_names[i], seconds > 0 ? sim_stats.load_uc[i] / seconds : 0.0);
+        }
+        printf(" uA\n");
+        if (mean_ma > 0)
+        {
+            double hours = cfg->battery_mah / mean_ma;
+            printf("battery life   %.0f h (%.1f days) from a %.0f mAh cell at this draw\n",
+                   hours, hours / 24.0, cfg->battery_mah);
+        }
+    }
+    printf("sleep          LPM3 %.3f%%, LPM0 %.3f%% of simulated time, %llu LPM3 ticks with an ADC conversion in flight\n",
+           seconds > 0 ? 100.0 * sim_ticks_to_s(sim_stats.lpm3_ticks) / seconds : 0.0,
+           seconds > 0 ? 100.0 * sim_ticks_to_s(sim_stats.now - sim_stats.active_ticks - sim_stats.lpm3_ticks) / seconds : 0.0,
+           (unsigned long long)sim_stats.lpm3_adc_ticks);
+#if TICK_STATS_ENABLE
+    // read back the firmware's FRAM statistics block
+    printf("tick stats     %lu ticks, %lu missed, %lu overruns, max latency %u ACLK counts (%.0f us)\n",
+           (unsigned long)tick_stats.ticks, (unsigned long)tick_stats.missed_ticks, (unsigned long)tick_stats.overruns,
+           tick_stats.max_latency, 1e6 * sim_ticks_to_s(tick_stats.max_latency));
+    printf("latency hist  ");
+    for (i = 0; i < TICK_STATS_BINS; i++)
+    {
+        unsigned lo = (unsigned)i << TICK_STATS_BIN_SHIFT;
+        if (i == TICK_STATS_BINS - 1)
+        {
+            printf(" %u+:%lu", lo, (unsigned long)tick_stats.latency_hist[i]);
+        }
+        else
+        {
+            printf(" %u-%u:%lu", lo, lo + (1u << TICK_STATS_BIN_SHIFT) - 1, (unsigned long)tick_stats.latency_hist[i]);
+        }
+    }
+    printf("\n");
+#endif
+#if TASK_STATS_ENABLE
+    {
+        // read back the firmware's per-task accounting, indexed by TASK_x
+        static const char *const task_names[TASK_COUNT] = {"animation", "light", "battery", "switch", "persist", "clock"};
+        printf("%-14s %10s %9s %10s %8s %7s\n", "task", "jobs", "run time", "mean us", "max us", "misses");
+        for (i = 0; i < TASK_COUNT; i++)
+        {
+            const TaskStats *ts = &earrings_tasks[i].stats;
+            printf("%-14s %10lu %8.3f%% %10.1f %8.0f %7u\n", task_names[i], (unsigned long)ts->jobs,
+                   seconds > 0 ? 100.0 * sim_ticks_to_s(ts->run_time) / seconds : 0.0,
+                   ts->jobs ? 1e6 * sim_ticks_to_s(ts->run_time) / ts->jobs : 0.0,
+                   1e6 * sim_ticks_to_s(ts->max_run), ts->misses);
+        }
+    }
+#endif
+    printf("events         %u lost\n", event_queue_stats.lost);
+    {
+        // LED1..LED9 are the pins after LOW_BATT_LED
+        uint64_t first_led = SIM_NEVER;
+        char led_ms[32], xt1_ms[32], aclk_ms[32];
+        for (i = 1; i < sim_pin_count && i <= 9; i++)
+        {
+            if (sim_stats.pins[i].first_edge < first_led)
+            {
+                first_led = sim_stats.pins[i].first_edge;
+            }
+        }
+        printf("boot           first LED edge %s, XT1 stable %s, ACLK on XT1 %s\n",
+               format_ms(first_led, led_ms, sizeof(led_ms)), format_ms(sim_stats.xt1_stable_tick, xt1_ms, sizeof(xt1_ms)),
+               format_ms(sim_stats.aclk_xt1_tick, aclk_ms, sizeof(aclk_ms)));
+    }
+    printf("governor       level %u, %u LEDs at a time, brightness cap %u\n",
+           governor_level(), governor_led_count(), governor_brightness_cap());
+    printf("%-14s %8s %10s\n", "pin", "duty", "edges");
+    for (i = 0; i < sim_pin_count; i++)
+    {
+        printf("%-14s %7.3f%% %10llu\n", sim_pins[i].name,
+               sim_stats.now ? 100.0 * sim_stats.pins[i].high_ticks / sim_stats.now : 0.0,
+               (unsigned long long)sim_stats.pins[i].edges);
+    }
+}
+
+/**
+ * @brief Host simulator entry point.
+ * @param argc Argument count.
+ * @param argv Arguments, see usage().
+ * @return Exit status.
+ */
+int main(int argc, char **argv)
+{
+    SimConfig cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.seconds = 10.0;
+    cfg.cycles_per_insn = 3.0;
+    cfg.light_level = 32.5;
+    cfg.vbat_mv = 3000;
+    cfg.dvcc_mv = 3300;
+    cfg.xt1_start_ms = 500.0;
+    cfg.battery_mah = SIM_BATTERY_MAH;
+    double led_ma = SIM_LED_MA;
+    const char *fram_path = NULL;
+
+    int i;
+    for (i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (!val)
+        {
+            usage(argv[0]);
+        }
+        if (!strcmp(arg, "--seconds"))       cfg.seconds = atof(val);
+        else if (!strcmp(arg, "--cpi"))      cfg.cycles_per_insn = atof(val);
+        else if (!strcmp(arg, "--light"))    cfg.light_level = atof(val);
+        else if (!strcmp(arg, "--vbat-mv"))  cfg.vbat_mv = (uint16_t)atoi(val);
+        else if (!strcmp(arg, "--vbat-end-mv")) cfg.vbat_end_mv = (uint16_t)atoi(val);
+        else if (!strcmp(arg, "--dvcc-mv"))  cfg.dvcc_mv = (uint16_t)atoi(val);
+        else if (!strcmp(arg, "--dvcc-end-mv")) cfg.dvcc_end_mv = (uint16_t)atoi(val);
+        else if (!strcmp(arg, "--vcd"))      cfg.vcd = open_output(val);
+        else if (!strcmp(arg, "--ticks"))    cfg.ticks = open_output(val);
+        else if (!strcmp(arg, "--from"))     cfg.trace_from = atof(val);
+        else if (!strcmp(arg, "--to"))       cfg.trace_to = atof(val);
+        else if (!strcmp(arg, "--xt1-ms"))   cfg.xt1_start_ms = atof(val);
+        else if (!strcmp(arg, "--fram"))     fram_path = val;
+        else if (!strcmp(arg, "--led-ma"))   led_ma = atof(val);
+        else if (!strcmp(arg, "--battery-mah")) cfg.battery_mah = atof(val);
+        else if (!strcmp(arg, "--bounce"))   cfg.bounce = (uint16_t)atoi(val);
+        else if (!strcmp(arg, "--press") && cfg.press_count < SIM_MAX_PRESSES)
+        {
+            cfg.presses_ms[cfg.press_count++] = atof(val);
+        }
+        else
+        {
+            usage(argv[0]);
+        }
+        i++;
+    }
+
+    sim_add_pin("LOW_BATT_LED", LOW_BATT_LED_PORT, LOW_BATT_LED, led_ma);
+    sim_add_pin("LED1", LED1_PORT, LED1, led_ma);
+    sim_add_pin("LED2", LED2_PORT, LED2, led_ma);
+    sim_add_pin("LED3", LED3_PORT, LED3, led_ma);
+    sim_add_pin("LED4", LED4_PORT, LED4, led_ma);
+    sim_add_pin("LED5", LED5_PORT, LED5, led_ma);
+    sim_add_pin("LED6", LED6_PORT, LED6, led_ma);
+    sim_add_pin("LED7", LED7_PORT, LED7, led_ma);
+    sim_add_pin("LED8", LED8_PORT, LED8, led_ma);
+    sim_add_pin("LED9", LED9_PORT, LED9, led_ma);
+    sim_add_pin("TICK_DEBUG", 3, BIT0, 0);
+    sim_add_pin("SECOND_DEBUG", 6, BIT6, 0);
+
+    if (!sim_load_own_block_costs((uintptr_t)init_earrings))
+    {
+        fprintf(stderr, "sim: no block cost file, charging %d instructions per block\n", SIM_DEFAULT_BLOCK_INSNS);
+    }
+
+    sim_reset(&cfg);
+    if (fram_path)
+    {
+        printf("resume         %s\n", load_fram(fram_path) ? "FRAM state loaded" : "no FRAM state, cold start");
+    }
+    sim_run(firmware_entry);
+    print_report(&cfg);
+    if (fram_path)
+    {
+        save_fram(fram_path);
+    }
+
+    if (cfg.vcd) fclose(cfg.vcd);
+    if (cfg.ticks) fclose(cfg.ticks);
+    return EXIT_SUCCESS;
+}
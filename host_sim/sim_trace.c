@@ -0,0 +1,167 @@
+/**
+ * @file sim_trace.c
+ * @brief Per-pin PWM traces (VCD) and per-wakeup cost records (CSV) for the host simulator.
+ * @ingroup HOST_SIM
+ */
+
+#include "sim.h"
+
+// private variables
+static const SimConfig *trace_cfg;
+static uint64_t window_from;
+static uint64_t window_to;
+static uint8_t vcd_started = 0;
+static uint16_t pin_levels = 0;        // one bit per traced pin
+static uint64_t pin_changed_at[SIM_MAX_PINS];
+static uint64_t last_vcd_time = UINT64_MAX;
+
+/**
+ * @brief Convert ACLK ticks to nanoseconds, exactly: 1e9 / 32768 = 1953125 / 64.
+ */
+static uint64_t ticks_to_ns(uint64_t ticks)
+{
+    return ticks * 1953125u / 64u;
+}
+
+static uint8_t in_window(uint64_t now)
+{
+    return now >= window_from && now <= window_to;
+}
+
+static uint16_t sample_pins(void)
+{
+    uint16_t levels = 0;
+    uint8_t i;
+    for (i = 0; i < sim_pin_count; i++)
+    {
+        if (sim_pin_level(sim_pins[i].port, sim_pins[i].mask))
+        {
+            levels |= (uint16_t)(1u << i);
+        }
+    }
+    return levels;
+}
+
+static void vcd_dump(uint64_t now, uint16_t levels, uint16_t changed)
+{
+    if (last_vcd_time != now)
+    {
+        fprintf(trace_cfg->vcd, "#%llu\n", (unsigned long long)ticks_to_ns(now));
+        last_vcd_time = now;
+    }
+    uint8_t i;
+    for (i = 0; i < sim_pin_count; i++)
+    {
+        if (changed & (1u << i))
+        {
+            fprintf(trace_cfg->vcd, "%c%c\n", (levels & (1u << i)) ? '1' : '0', '!' + i);
+        }
+    }
+}
+
+void sim_trace_begin(const SimConfig *cfg)
+{
+    trace_cfg = cfg;
+    window_from = (uint64_t)(cfg->trace_from * SIM_ACLK_HZ);
+    window_to = (cfg->trace_to > 0) ? (uint64_t)(cfg->trace_to * SIM_ACLK_HZ) : UINT64_MAX;
+    vcd_started = 0;
+    pin_levels = 0;
+    last_vcd_time = UINT64_MAX;
+
+    uint8_t i;
+    for (i = 0; i < SIM_MAX_PINS; i++)
+    {
+        pin_changed_at[i] = 0;
+    }
+
+    if (cfg->vcd)
+    {
+        fprintf(cfg->vcd, "$timescale 1ns $end\n$scope module earrings $end\n");
+        for (i = 0; i < sim_pin_count; i++)
+        {
+            fprintf(cfg->vcd, "$var wire 1 %c %s $end\n", '!' + i, sim_pins[i].name);
+        }
+        fprintf(cfg->vcd, "$upscope $end\n$enddefinitions $end\n");
+    }
+    if (cfg->ticks)
+    {
+        fprintf(cfg->ticks, "wake,t_s,sources,blocks,insns,cycles\n");
+    }
+}
+
+void sim_trace_pins(uint64_t now)
+{
+    uint16_t levels = sample_pins();
+    uint16_t changed = levels ^ pin_levels;
+
+    if (trace_cfg->vcd && !vcd_started && in_window(now))
+    {
+        vcd_started = 1;
+        vcd_dump(now, levels, (uint16_t)((1u << sim_pin_count) - 1u));
+    }
+    else if (changed && trace_cfg->vcd && vcd_started && in_window(now))
+    {
+        vcd_dump(now, levels, changed);
+    }
+
+    if (!changed)
+    {
+        return;
+    }
+    uint8_t i;
+    for (i = 0; i < sim_pin_count; i++)
+    {
+        if (changed & (1u << i))
+        {
+            if (pin_levels & (1u << i))
+            {
+                sim_stats.pins[i].high_ticks += now - pin_changed_at[i];
+            }
+            if (!sim_stats.pins[i].edges)
+            {
+                sim_stats.pins[i].first_edge = now;
+            }
+            sim_stats.pins[i].edges++;
+            pin_changed_at[i] = now;
+        }
+    }
+    pin_levels = levels;
+}
+
+void sim_trace_wake(uint64_t wake, uint64_t start, uint32_t sources, uint64_t blocks, uint64_t insns, uint64_t cycles)
+{
+    if (!trace_cfg->ticks || !in_window(start))
+    {
+        return;
+    }
+    fprintf(trace_cfg->ticks, "%llu,%.6f,", (unsigned long long)wake, sim_ticks_to_s(start));
+    uint8_t first = 1;
+    uint8_t i;
+    for (i = 0; i < SIM_SRC_COUNT; i++)
+    {
+        if (sources & (1u << i))
+        {
+            fprintf(trace_cfg->ticks, "%s%s", first ? "" : "+", sim_source_names[i]);
+            first = 0;
+        }
+    }
+    fprintf(trace_cfg->ticks, ",%llu,%llu,%llu\n",
+            (unsigned long long)blocks, (unsigned long long)insns, (unsigned long long)cycles);
+}
+
+void sim_trace_end(uint64_t now)
+{
+    uint8_t i;
+    for (i = 0; i < sim_pin_count; i++)
+    {
+        if (pin_levels & (1u << i))
+        {
+            sim_stats.pins[i].high_ticks += now - pin_changed_at[i];
+            pin_changed_at[i] = now;
+        }
+    }
+    if (trace_cfg->vcd && last_vcd_time != now)
+    {
+        fprintf(trace_cfg->vcd, "#%llu\n", (unsigned long long)ticks_to_ns(now));
+    }
+}
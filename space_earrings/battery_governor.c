@@ -0,0 +1,152 @@
+/**
+ * @file battery_governor.c
+ * @brief Battery-aware LED duty budget: picks the animation and brightness cap from the battery reading.
+ * @ingroup BATTERY_GOVERNOR
+ */
+#include "battery_governor.h"
+#include "led_control.h"
+#include "drivers/gpio.h"
+#include "drivers/adc.h"
+#include "drivers/clock.h"
+#include <stdint.h>
+
+#if LED_PWM_BACKEND == LED_PWM_TIMER
+#define GOVERNOR_MAX_LEDS   2   // TB0 has two compare channels, no twinkle_three()
+#else
+#define GOVERNOR_MAX_LEDS   3
+#endif
+
+/** One duty budget level: the lowest battery reading it applies to and the LED duty it may spend. */
+typedef struct
+{
+    uint16_t min_reading;   // mV; the last level runs down to the BATT_LOW cutoff in batt_low_handler()
+    uint16_t duty_budget;   // LEDs lit at once x brightness cap, in GOVERNOR_FULL_SCALE units per LED
+} GovernorLevel;
+
+// private variables
+// budget levels from a fresh cell down to the cutoff - const, so they stay in FRAM. Brightness is CIE lightness, so
+// the half brightness of the last level is already under a fifth of the duty.
+static const GovernorLevel governor_levels[GOVERNOR_LEVELS] = {
+    {3050, 3 * GOVERNOR_FULL_SCALE},        // twinkle_three at full brightness
+    {2850, 2 * GOVERNOR_FULL_SCALE},        // twinkle_two at full brightness
+    {2700, 1 * GOVERNOR_FULL_SCALE},        // twinkle_one at full brightness
+    {2600, GOVERNOR_FULL_SCALE * 3 / 4},    // twinkle_one at 3/4 brightness
+    {0,    GOVERNOR_FULL_SCALE / 2},        // twinkle_one at half brightness
+};
+// until the first battery reading the budget is the lowest, since nothing is known about the cell yet
+static uint8_t level = GOVERNOR_LEVELS - 1;
+static uint8_t have_reading = 0;
+static uint8_t led_count = 1;
+static void (*animation)(uint8_t brightness) = twinkle_one;    // picked once per level change, not per tick
+static uint8_t brightness_cap = GOVERNOR_FULL_SCALE / 2;
+
+// private functions
+void apply_level(uint8_t new_level);
+
+/**
+ * @brief Private function to battery_governor.c: switch to a budget level and split its budget into LEDs and brightness.
+ * @ingroup BATTERY_GOVERNOR
+ * @param new_level Level index into governor_levels.
+ * @note This is an internal helper; it is not exposed in the public header.
+ */
+void apply_level(uint8_t new_level)
+{
+    uint16_t budget = governor_levels[new_level].duty_budget;
+    uint16_t cap;
+
+    // as many LEDs as the budget covers at full brightness, then the brightness that spreads the budget over them
+    led_count = (uint8_t)(budget / GOVERNOR_FULL_SCALE);
+    if (led_count > GOVERNOR_MAX_LEDS)
+    {
+        led_count = GOVERNOR_MAX_LEDS;
+    }
+    else if (led_count == 0)
+    {
+        led_count = 1;
+    }
+#if LED_PWM_BACKEND != LED_PWM_TIMER
+    animation = (led_count == 3) ? twinkle_three : (led_count == 2) ? twinkle_two : twinkle_one;
+#else
+    animation = (led_count == 2) ? twinkle_two : twinkle_one;
+#endif
+    cap = budget / led_count;
+    brightness_cap = (cap > GOVERNOR_FULL_SCALE) ? GOVERNOR_FULL_SCALE : (uint8_t)cap;
+
+    if (new_level != level)
+    {
+        // the next animation starts from its start state, with none of the old one's LEDs left lit
+        level = new_level;
+        stop_animation();
+        turn_off_all_leds();
+    }
+}
+
+void governor_update(uint16_t battery_reading)
+{
+    uint8_t new_level = level;
+
+    if (!have_reading)
+    {
+        // first reading: go straight to its level, up or down
+        new_level = 0;
+        have_reading = 1;
+    }
+    else if (level > 0 && battery_reading >= governor_levels[level - 1].min_reading + GOVERNOR_HYSTERESIS)
+    {
+        apply_level(level - 1);
+        return;
+    }
+
+    while (new_level < GOVERNOR_LEVELS - 1 && battery_reading < governor_levels[new_level].min_reading)
+    {
+        new_level++;
+    }
+    apply_level(new_level);
+}
+
+RAMFUNC void governor_run(uint8_t brightness)
+{
+    if (brightness > brightness_cap)
+    {
+        brightness = brightness_cap;
+    }
+
+    animation(brightness);
+}
+
+uint8_t governor_level(void)
+{
+    return level;
+}
+
+uint8_t governor_led_count(void)
+{
+    return led_count;
+}
+
+uint8_t governor_brightness_cap(void)
+{
+    return brightness_cap;
+}
+
+uint16_t governor_window_low(void)
+{
+    if (!have_reading)
+    {
+        return 0xFFFF;
+    }
+    return (level == GOVERNOR_LEVELS - 1) ? BATT_LOW : governor_levels[level].min_reading;
+}
+
+uint16_t governor_window_high(void)
+{
+    if (!have_reading)
+    {
+        return 0;
+    }
+    if (level == 0)
+    {
+        return 0xFFFF;
+    }
+    return governor_levels[level - 1].min_reading + GOVERNOR_HYSTERESIS - 1;
+}
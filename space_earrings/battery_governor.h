@@ -0,0 +1,79 @@
+/**
+ * @file battery_governor.h
+ * @brief Battery-aware LED duty budget: picks the animation and brightness cap from the battery reading.
+ */
+
+#ifndef BATTERY_GOVERNOR_H
+#define BATTERY_GOVERNOR_H
+
+#include <stdint.h>
+
+/**
+ * @defgroup BATTERY_GOVERNOR Battery duty governor
+ * @brief Battery-aware LED duty budget: picks the animation and brightness cap from the battery reading.
+ * @{
+ */
+
+#define GOVERNOR_LEVELS             5   // duty budget levels, see governor_levels in battery_governor.c
+#define GOVERNOR_HYSTERESIS         50  // mV: a level is only regained this far above its floor
+#define GOVERNOR_FULL_SCALE         255 // one LED at full brightness, the unit of the duty budget
+
+/**
+ * @brief Update the duty budget from a new battery reading.
+ * @ingroup BATTERY_GOVERNOR
+ * @param battery_reading Battery voltage in mV, as passed to batt_low_handler().
+ * @note Drops straight to the level the reading allows, but climbs back one level per reading and only once the
+ *       reading is GOVERNOR_HYSTERESIS above that level's floor, so the voltage recovering under the lighter load
+ *       does not toggle it. A level change stops the running animation and turns the LEDs off.
+ */
+void governor_update(uint16_t battery_reading);
+
+/**
+ * @brief Advance the animation that fits the current duty budget, with the brightness capped to the budget.
+ * @ingroup BATTERY_GOVERNOR
+ * @param brightness Current logical brightness level or PWM scaling factor.
+ * @note Runs twinkle_three(), twinkle_two() or twinkle_one(). With LED_PWM_TIMER twinkle_three() does not exist,
+ *       so a budget for three LEDs runs twinkle_two().
+ */
+void governor_run(uint8_t brightness);
+
+/**
+ * @brief Return the current duty budget level.
+ * @ingroup BATTERY_GOVERNOR
+ * @return Level index, 0 = full budget, GOVERNOR_LEVELS - 1 = lowest before the BATT_LOW cutoff.
+ */
+uint8_t governor_level(void);
+
+/**
+ * @brief Return the number of LEDs the current animation lights at once.
+ * @ingroup BATTERY_GOVERNOR
+ * @return 1, 2 or 3.
+ */
+uint8_t governor_led_count(void);
+
+/**
+ * @brief Return the brightness cap of the current level.
+ * @ingroup BATTERY_GOVERNOR
+ * @return Highest brightness passed on to the animation.
+ */
+uint8_t governor_brightness_cap(void);
+
+/**
+ * @brief Return the lowest battery reading that keeps the current level.
+ * @ingroup BATTERY_GOVERNOR
+ * @return mV; BATT_LOW for the last level, which runs down to the cutoff. Before the first reading this is
+ *         above governor_window_high(), so every reading counts.
+ * @note With ADC_MEASURE_WINDOW, run_earrings() hands this window to adc_set_window(), so only a reading that would
+ *       change the level wakes it.
+ */
+uint16_t governor_window_low(void);
+
+/**
+ * @brief Return the highest battery reading that keeps the current level.
+ * @ingroup BATTERY_GOVERNOR
+ * @return mV.
+ */
+uint16_t governor_window_high(void);
+
+/** @} */
+#endif //BATTERY_GOVERNOR_H
@@ -3,66 +3,158 @@
  * @brief Brightness control specific functionalities.
  * @ingroup BRIGHTNESS_CONTROL
  */
+#include "brightness_control.h"
 #include "drivers/opamp.h"
 #include <stdint.h>
 
  
-uint8_t brightness_check(void)
-{
-    // firstly clear any comparator flags
-    reset_comp_high_to_low();
-    reset_comp_low_to_high();
-    enable_comp_interrupts();
+// private variables
+static uint8_t measure_busy = 0;            // a measurement is in progress
+static uint8_t measure_ready = 0;           // completion flag, like conversion_ready in the ADC driver
+static uint8_t measure_result = 0;          // last completed measurement, in DAC steps
+#if BRIGHTNESS_SEARCH == BRIGHTNESS_SEARCH_BINARY
+static uint8_t measure_code = 0;            // DAC code built up so far
+static uint8_t measure_bit = 0;             // DAC bit under test
+#else
+// only going through some of the values to make it quicker. 
+//uint8_t dac_settings[8] = {28,24, 20, 16, 12, 8, 4, 0};
+//uint8_t dac_settings[8] = {63,55, 47, 39, 31, 23, 15, 7};
+#define dac_settings_size   17
+static const uint8_t dac_settings[dac_settings_size] = {63, 59, 55, 51, 47, 43, 39, 35, 31, 27, 23, 19, 15, 11, 7, 3, 0};
+static uint8_t measure_index = 0;           // next entry of dac_settings to try
+#endif
 
-    // only going through some of the values to make it quicker. 
-    //uint8_t dac_settings[8] = {28,24, 20, 16, 12, 8, 4, 0};
-    //uint8_t dac_settings[8] = {63,55, 47, 39, 31, 23, 15, 7};
-    uint8_t size = 17;
-    uint8_t dac_settings[17] = {63, 59, 55, 51, 47, 43, 39, 35, 31, 27, 23, 19, 15, 11, 7, 3, 0};
-    uint8_t i = 0;
-
-    // we want to go from bright to dim - so decrease the DAC setting and look for a high to low transition.
-    do{
-        set_dac_multiplier(dac_settings[i]);
-        i++;
-    } while (!get_comp_high_to_low() & (i<size));
+// private functions
+void finish_measurement(uint8_t result);
 
+/**
+ * @brief Private function to brightness_control.c: latch a measurement result and park the comparator.
+ * @ingroup BRIGHTNESS_APP
+ * @param result Measured light level in DAC steps.
+ * @note This is an internal helper; it is not exposed in the public header.
+ */
+void finish_measurement(uint8_t result)
+{
     // set dac back to something really high so it is not constantly triggering. 
     set_dac_multiplier(63);
+#if BRIGHTNESS_SEARCH == BRIGHTNESS_SEARCH_LINEAR
     disable_comp_interrupts();
-    
-    if (i==size) return dac_settings[0];
-    
-    return dac_settings[i];
+#endif
+    measure_result = result;
+    measure_busy = 0;
+    measure_ready = 1;
+}
 
+#if BRIGHTNESS_SEARCH == BRIGHTNESS_SEARCH_BINARY
+void brightness_start(void)
+{
+    if (measure_busy)
+    {
+        return;
+    }
+    measure_busy = 1;
+
+    // successive approximation, MSB first
+    measure_code = 0;
+    measure_bit = 0x20;
+    set_dac_multiplier(measure_bit);
 }
 
- uint8_t update_ma_size_8(uint8_t new_item, uint8_t* ring_buff, uint8_t* ring_buff_iter)
- {
-    uint8_t ring_buff_size = 8;
-    // place new item into the ring_buff with the correct location. 
-    ring_buff[*ring_buff_iter] = new_item;
+void brightness_step(void)
+{
+    if (!measure_busy)
+    {
+        return;
+    }
 
-    // update iterator for circular buffer
-    *ring_buff_iter += 1;
-    if (*ring_buff_iter >= ring_buff_size)
+    // keep the bit under test if it leaves the DAC at or below the light signal (CPOUT low)
+    if (!get_comp_output())
     {
-        *ring_buff_iter = 0;
+        measure_code |= measure_bit;
     }
+    measure_bit >>= 1;
 
-    // get ma of the new buffer.
-    int sum = 0;
-    int j = 0;
-    for (j = 0; j<ring_buff_size; j++)
+    if (measure_bit)
+    {
+        set_dac_multiplier(measure_code | measure_bit);
+    }
+    else
+    {
+        finish_measurement(measure_code);
+    }
+}
+#else
+void brightness_start(void)
+{
+    if (measure_busy)
     {
-        sum += ring_buff[j];
+        return;
     }
+    measure_busy = 1;
 
-    return (uint8_t)(sum >> 3);
+    // firstly clear any comparator flags
+    reset_comp_high_to_low();
+    reset_comp_low_to_high();
+    enable_comp_interrupts();
 
- }
+    // we want to go from bright to dim - so decrease the DAC setting and look for a high to low transition.
+    set_dac_multiplier(dac_settings[0]);
+    measure_index = 1;
+}
+
+void brightness_step(void)
+{
+    if (!measure_busy)
+    {
+        return;
+    }
+
+    if (get_comp_high_to_low() || (measure_index == dac_settings_size))
+    {
+        // no transition, or one only at the last setting: report the top of the range
+        if (measure_index == dac_settings_size)
+        {
+            finish_measurement(dac_settings[0]);
+        }
+        else
+        {
+            finish_measurement(dac_settings[measure_index]);
+        }
+    }
+    else
+    {
+        set_dac_multiplier(dac_settings[measure_index]);
+        measure_index++;
+    }
+}
+#endif
+
+uint8_t is_brightness_ready(void)
+{
+    return measure_ready;
+}
+
+void clear_brightness_ready(void)
+{
+    measure_ready = 0;
+}
+
+uint8_t get_brightness_value(void)
+{
+    return measure_result;
+}
+
+uint8_t brightness_check(void)
+{
+    brightness_start();
+    while (!is_brightness_ready())
+    {
+        brightness_step();
+    }
+    clear_brightness_ready();
+    return get_brightness_value();
+}
 
- 
 uint8_t get_scaled_brightness(uint8_t brightness)
 {
     //brightness max = 255 as scaled to 63
@@ -8,31 +8,63 @@
 
 #include <stdint.h>
 
+// ambient light measurement selection for brightness_check()
+#define BRIGHTNESS_SEARCH_LINEAR        0   // step the DAC down through 17 settings until the comparator edge interrupt
+#define BRIGHTNESS_SEARCH_BINARY        1   // successive approximation on CPOUT over the full 6-bit DAC, 6 steps
+
+#ifndef BRIGHTNESS_SEARCH
+#define BRIGHTNESS_SEARCH               BRIGHTNESS_SEARCH_BINARY
+#endif
+
 /**
  * @defgroup BRIGHTNESS_CONTROL LED brightness control
  * @brief Functions for checking ambient light level and adjusting LED brightness accordingly.
  * @{
  */
 
- /**
- * @brief Measure ambient light using the comparator and update the internal brightness level.
+/**
+ * @brief Start a non-blocking ambient light measurement. Does nothing if one is already in progress.
+ * @ingroup BRIGHTNESS_APP
+ * @note Sets the first DAC threshold. brightness_step() then takes one DAC step per call, and is_brightness_ready()
+ *       reports completion - 6 steps with BRIGHTNESS_SEARCH_BINARY, up to 17 with BRIGHTNESS_SEARCH_LINEAR.
+ */
+void brightness_start(void);
+
+/**
+ * @brief Advance the ambient light measurement by one DAC step. Returns straight away when no measurement is running.
+ * @ingroup BRIGHTNESS_APP
+ * @note Call once per wakeup. The comparator needs COMP_SETTLE_CYCLES after each DAC write, which a wakeup interval covers.
+ */
+void brightness_step(void);
+
+/**
+ * @brief Check whether a new ambient light measurement is available.
+ * @ingroup BRIGHTNESS_APP
+ * @return Return measurement ready bool.
+ */
+uint8_t is_brightness_ready(void);
+
+/**
+ * @brief Clear the measurement-ready flag after the result has been consumed.
+ * @ingroup BRIGHTNESS_APP
+ */
+void clear_brightness_ready(void);
+
+/**
+ * @brief Return the most recent ambient light measurement.
  * @ingroup BRIGHTNESS_APP
  * @return Returns the internal DAC setting that feeds into the comparator, which can be scaled later for brightness.
- * @note This is an internal helper; it is not exposed in the public header.
+ *         With BRIGHTNESS_SEARCH_BINARY this is the highest DAC code (0-63) at or below the light signal.
  */
-uint8_t brightness_check(void);
+uint8_t get_brightness_value(void);
 
 /**
- * @brief Maintain a rolling average of the incoming brightness values.
+ * @brief Measure ambient light using the comparator, blocking until the measurement completes.
  * @ingroup BRIGHTNESS_APP
- * @param new_item: new item to be placed in the ring_buff array.
- * @param ring_buff: An array passed as a pointer to be updated with the newest new_item value.
- * @param ring_buff_iter: the iterator that is incremented inside this function
- * @return Return the moving average of the new updated buffer.
- * @note *This moving average function only works for buffer size 8.* This is because we want to speed up the division by using bitshifting instead
- *        so we are limited to buffer sizes 2, 4, 8, 16... etc. 
- */
-uint8_t update_ma_size_8(uint8_t new_item, uint8_t* ring_buff, uint8_t* ring_buff_iter);
+ * @return Returns the internal DAC setting that feeds into the comparator, which can be scaled later for brightness.
+ * @note Runs brightness_start() and brightness_step() back to back. run_earrings() uses the non-blocking calls instead.
+ */
+uint8_t brightness_check(void);
 
 
 /**
@@ -5,12 +5,25 @@
  */
 
 #include "drivers/adc.h"
+#include "drivers/event_queue.h"
 #include <stdint.h>
 #include "msp430fr2355.h"
 
 volatile uint16_t ADC_Result = 0xFFFF; // start full range
 volatile uint8_t conversion_ready = 0; // start at not conversion ready
 
+// private variables
+static uint32_t adc_accumulator = 0;       // conversions of the measurement in progress, summed
+static volatile uint8_t adc_samples_left = 0; // conversions still to take; 0 = idle
+#if ADC_MEASURE == ADC_MEASURE_WINDOW
+static uint8_t adc_outside_window = 0;     // a conversion of this measurement tripped ADCLOIFG or ADCHIIFG
+static uint8_t adc_monitoring = 0;         // TB1.1 triggers the conversions, and only one outside the window interrupts
+#endif
+#if BATT_SENSE == BATT_SENSE_INTREF
+// ADC_INTREF_MV x full scale: a measurement of the reference divides this to give DVCC in mV
+#define ADC_INTREF_SCALE    ((uint32_t)ADC_INTREF_MV * (ADC_RESULT_MAX + 1))
+#endif
+
 void init_adc()
 {
     // Configure ADC A1 pin
@@ -26,7 +39,21 @@ void init_adc()
     ADCCTL2 &= ~ADCRES;                                      // clear ADCRES in ADCCTL
     ADCCTL2 |= ADCRES_2;                                     // 12-bit conversion results
     ADCIE |= ADCIE0;                                         // Enable ADC conv complete interrupt
+#if BATT_SENSE == BATT_SENSE_INTREF
+    // the internal reference is also enabled by init_comp(), but the ADC should not depend on that
+    PMMCTL0_H = PMMPW_H;                                     // Unlock the PMM registers
+    PMMCTL2 |= INTREFEN;                                     // Enable internal reference
+    while(!(PMMCTL2 & REFGENRDY));                           // Poll till internal reference settles
+    ADCCTL0 = (ADCCTL0 & ~ADCSHT) | ADCSHT_8;                // S&H=256 ADC clks, ~50 us: the reference buffer is slow to settle
+    ADCMCTL0 |= ADCINCH_13 | ADCSREF_0;                       // 1.5V reference input select; Vref=DVCC
+#else
     ADCMCTL0 |= ADCINCH_1 | ADCSREF_0;                        // A1 ADC input select; Vref=DVCC
+#endif
+#if ADC_MEASURE == ADC_MEASURE_WINDOW
+    ADCIE |= ADCLOIE | ADCHIIE;                              // window comparator: below ADCLO, above ADCHI
+    TB1CCTL1 = OUTMOD_4;                                     // TB1.1 toggles as the free-running TB1R passes TB1CCR1
+    adc_set_window(1, 0);                                    // report everything until the application sets a window
+#endif
 
     // kick off first conversion
     adc_start();
@@ -35,17 +62,115 @@ void init_adc()
 
 void adc_start()
 {
+    if (adc_samples_left)
+    {
+        return;
+    }
+    adc_accumulator = 0;
+    adc_samples_left = ADC_OVERSAMPLE;
+#if ADC_MEASURE == ADC_MEASURE_WINDOW
+    adc_outside_window = 0;
+#endif
     ADCCTL0 |= ADCENC | ADCSC;                           // Sampling and conversion start
 }
 
-uint16_t get_adc_value()
+uint16_t adc_to_mv(uint16_t reading)
 {
-    return ADC_Result;
+#if BATT_SENSE == BATT_SENSE_INTREF
+    if (reading == 0)
+    {
+        return 0xFFFF;                                   // reference at zero counts: DVCC off the scale
+    }
+    return (uint16_t)(ADC_INTREF_SCALE / reading);
+#else
+    return (uint16_t)((uint32_t)reading * ADC_DVCC_MV / ADC_RESULT_MAX);
+#endif
+}
+
+#if ADC_MEASURE == ADC_MEASURE_WINDOW
+/**
+ * @brief Private function to adc.c: leave the ADC converting on its own until a conversion leaves the window.
+ * @ingroup ADC_DRIVER
+ * @note This is an internal helper; it is not exposed in the public header.
+ *       TB1.1 rises once every two TB1 wraps, so there is a conversion every 4 s on ACLK. ADCIE0 is off, so a
+ *       conversion inside the window neither interrupts nor wakes the CPU.
+ */
+static void adc_monitor_start(void)
+{
+    ADCCTL0 &= ~ADCENC;
+    ADCIE &= ~ADCIE0;
+    ADCIFG &= ~(ADCIFG0 | ADCLOIFG | ADCHIIFG | ADCINIFG);
+    ADCCTL1 = (ADCCTL1 & ~(ADCSHS | ADCCONSEQ)) | ADCSHS_2 | ADCCONSEQ_2; // TB1.1B trigger, repeat single channel
+    adc_monitoring = 1;
+    ADCCTL0 |= ADCENC;
+}
+
+/**
+ * @brief Private function to adc.c: go back to measurements started by adc_start().
+ * @ingroup ADC_DRIVER
+ * @note This is an internal helper; it is not exposed in the public header.
+ */
+static void adc_monitor_stop(void)
+{
+    ADCCTL0 &= ~ADCENC;
+    ADCCTL1 &= ~(ADCSHS | ADCCONSEQ);                    // ADCSC trigger, single conversion
+    ADCIFG &= ~ADCIFG0;                                  // a triggered conversion is not part of a measurement
+    ADCIE |= ADCIE0;
+    adc_monitoring = 0;
+}
+
+void adc_set_window(uint16_t low, uint16_t high)
+{
+    uint32_t code_low;
+    uint32_t code_high;
+
+    if (low > high)
+    {
+        // every conversion is either below ADCLO or above ADCHI
+        code_low = ADC_RESULT_MAX;
+        code_high = 0;
+    }
+    else
+    {
+        // the measurements whose adc_to_mv() falls inside [low, high]
+#if BATT_SENSE == BATT_SENSE_INTREF
+        // the reference reads fewer counts the higher DVCC is, so the window turns over
+        code_low = ADC_INTREF_SCALE / ((uint32_t)high + 1) + 1;
+        code_high = low ? ADC_INTREF_SCALE / low : ADC_RESULT_MAX;
+#else
+        code_low = ((uint32_t)low * ADC_RESULT_MAX + ADC_DVCC_MV - 1) / ADC_DVCC_MV;
+        code_high = (((uint32_t)high + 1) * ADC_RESULT_MAX + ADC_DVCC_MV - 1) / ADC_DVCC_MV - 1;
+#endif
+        if (code_high > ADC_RESULT_MAX)
+        {
+            code_high = ADC_RESULT_MAX;
+        }
+    }
+
+    // the comparator sees single 12-bit conversions. Rounding the window inwards means a measurement outside it
+    // always has a conversion outside it too.
+    ADCCTL0 &= ~ADCENC;
+    ADCLO = (uint16_t)((code_low + (1u << ADC_EXTRA_BITS) - 1) >> ADC_EXTRA_BITS);
+    ADCHI = (uint16_t)(code_high >> ADC_EXTRA_BITS);
+    if (low > high)
+    {
+        adc_monitor_stop();
+    }
+    else
+    {
+        adc_monitor_start();
+    }
+}
+#endif
+
+uint8_t adc_busy()
+{
+    return adc_samples_left;
 }
 
-uint8_t is_conversion_ready()
+uint16_t get_adc_value()
 {
-    return conversion_ready;
+    return ADC_Result;
 }
 
 void clear_conversion_ready()
@@ -70,14 +195,41 @@ __interrupt void ADC_ISR(void)
         case ADCIV_ADCTOVIFG:
             break;
         case ADCIV_ADCHIIFG:
-            break;
         case ADCIV_ADCLOIFG:
+#if ADC_MEASURE == ADC_MEASURE_WINDOW
+            if (adc_monitoring)
+            {
+                // a triggered conversion has left the window: the application takes a full measurement
+                adc_monitor_stop();
+                event_post(EVENT_ADC_READY);
+                __bic_SR_register_on_exit(LPM3_bits);   // wakeup main CPU
+                break;
+            }
+            adc_outside_window = 1;
+#endif
             break;
         case ADCIV_ADCINIFG:
             break;
         case ADCIV_ADCIFG:
-            ADC_Result = ADCMEM0;
-            conversion_ready = 1;
+            adc_accumulator += ADCMEM0;
+            if (--adc_samples_left)
+            {
+                ADCCTL0 |= ADCSC;                       // next conversion of the measurement
+                break;
+            }
+#if ADC_MEASURE == ADC_MEASURE_WINDOW
+            if (!adc_outside_window)
+            {
+                adc_monitor_start();                    // inside the window after all: nothing to report
+            }
+            else
+#endif
+            {
+                ADC_Result = (uint16_t)(adc_accumulator >> ADC_EXTRA_BITS);
+                conversion_ready = 1;
+            }
+            event_post(EVENT_ADC_READY);                // the measurement has finished either way
+            __bic_SR_register_on_exit(LPM3_bits);       // wakeup main CPU
             break;
         default:
             break;
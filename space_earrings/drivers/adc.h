@@ -17,33 +17,93 @@
 #define VBAT_SENSE_PIN      BIT1
 #define VBAT_SENSE_PORT     1
 
-#define BATT_LOW            3100 // 2.5V / 3.3V * 4095
+// what a measurement samples
+#define BATT_SENSE_PIN      0   // the VBAT sense pin (A1) against DVCC, taken to be ADC_DVCC_MV
+#define BATT_SENSE_INTREF   1   // the internal 1.5V reference (A13) against DVCC, which gives DVCC itself
+
+#ifndef BATT_SENSE
+#define BATT_SENSE          BATT_SENSE_PIN
+#endif
+
+// battery measurement selection
+#define ADC_MEASURE_POLLED  0   // every measurement is reported
+#define ADC_MEASURE_WINDOW  1   // the window comparator checks each conversion; only one outside adc_set_window() is reported
+
+#ifndef ADC_MEASURE
+#define ADC_MEASURE         ADC_MEASURE_POLLED
+#endif
+
+#ifndef ADC_OVERSAMPLE
+#define ADC_OVERSAMPLE      1   // conversions accumulated per measurement: 1, 4 (+1 bit) or 16 (+2 bits)
+#endif
+
+#if ADC_OVERSAMPLE == 1
+#define ADC_EXTRA_BITS      0
+#elif ADC_OVERSAMPLE == 4
+#define ADC_EXTRA_BITS      1
+#elif ADC_OVERSAMPLE == 16
+#define ADC_EXTRA_BITS      2
+#else
+#error "ADC_OVERSAMPLE must be 1, 4 or 16"
+#endif
+
+#define ADC_RESULT_MAX      ((4096u << ADC_EXTRA_BITS) - 1) // measurements are 12 + ADC_EXTRA_BITS bits
+#define ADC_DVCC_MV         3300    // Vref = DVCC, as BATT_SENSE_PIN assumes it
+#define ADC_INTREF_MV       1500    // internal reference, for BATT_SENSE_INTREF
+
+#define BATT_LOW            2500    // mV
 
 /**
- * @brief Initialise the ADC peripheral to measure battery voltage on the VBAT sense pin.
+ * @brief Initialise the ADC peripheral to measure battery voltage on the VBAT sense pin, or the internal reference
+ *        with BATT_SENSE_INTREF.
  * @ingroup ADC_DRIVER
  */
 void init_adc(void);
 
 /**
- * @brief Start a new ADC conversion on the configured channel.
+ * @brief Start a new measurement on the configured channel: ADC_OVERSAMPLE conversions back to back.
  * @ingroup ADC_DRIVER
+ * @note Does nothing while a measurement is still running. The ADC clocks itself from MODOSC, which it requests on its
+ *       own in LPM3, so the main loop can sleep in LPM3 while the conversions run.
  */
 void adc_start(void);
 
 /**
- * @brief Return the most recent ADC conversion result for the battery voltage.
+ * @brief Check whether a measurement is still running.
+ * @ingroup ADC_DRIVER
+ * @return Non-zero from adc_start() until the last conversion is in. The ISR then posts EVENT_ADC_READY, whether or
+ *         not the measurement was reported.
+ */
+uint8_t adc_busy(void);
+
+/**
+ * @brief Return the most recent ADC measurement of the battery voltage.
  * @ingroup ADC_DRIVER
- * @return Returns 12-bit ADC value.
+ * @return Returns the 12 + ADC_EXTRA_BITS bit measurement: the sum of the ADC_OVERSAMPLE conversions >> ADC_EXTRA_BITS.
  */
 uint16_t get_adc_value(void);
 
+extern volatile uint8_t conversion_ready;
+
+/**
+ * @brief Convert a measurement to the battery voltage.
+ * @ingroup ADC_DRIVER
+ * @param reading Measurement from get_adc_value().
+ * @return Battery voltage in mV. With BATT_SENSE_PIN this is reading x ADC_DVCC_MV / ADC_RESULT_MAX, which is only
+ *         right while DVCC really is ADC_DVCC_MV. With BATT_SENSE_INTREF it is ADC_INTREF_MV x full scale / reading,
+ *         the supply voltage whatever it has sagged to.
+ */
+uint16_t adc_to_mv(uint16_t reading);
+
 /**
- * @brief Check whether a new ADC conversion result is available.
+ * @brief Check whether a new ADC measurement is available.
  * @ingroup ADC_DRIVER
  * @return Return conversion ready bool.
  */
-uint8_t is_conversion_ready(void);
+static inline uint8_t is_conversion_ready(void)
+{
+    return conversion_ready;
+}
 
 /**
  * @brief Clear the ADC conversion-ready flag after the result has been consumed.
@@ -51,5 +111,22 @@ uint8_t is_conversion_ready(void);
  */
 void clear_conversion_ready(void);
 
+#if ADC_MEASURE == ADC_MEASURE_WINDOW
+/**
+ * @brief Set the window a measurement must leave to be reported. Measurements inside [low, high] do not set the
+ *        ready flag, so the application has nothing to do for them.
+ * @ingroup ADC_DRIVER
+ * @param low Lowest battery voltage that is not reported, in mV as from adc_to_mv().
+ * @param high Highest battery voltage that is not reported, in mV. low > high reports every measurement.
+ * @note The hardware compares each conversion against ADCLO/ADCHI, so with oversampling one conversion outside the
+ *       window reports the whole measurement, which may itself fall just inside.
+ * @note With a window set, TB1.1 triggers a single conversion every 4 s and no adc_start() is needed. One inside the
+ *       window does not interrupt. The first one outside it posts EVENT_ADC_READY with adc_busy() zero and nothing
+ *       reported; the application then takes a measurement with adc_start(). If that lands inside the window after
+ *       all, it is not reported and the triggered conversions carry on.
+ */
+void adc_set_window(uint16_t low, uint16_t high);
+#endif
+
 /** @} */
 #endif //ADC_H
@@ -0,0 +1,151 @@
+/**
+ * @file bam.c
+ * @brief Timer_B2 bit-angle modulation of all nine LEDs from per-bit-plane port masks.
+ * @ingroup BAM_DRIVER
+ */
+
+#include "drivers/bam.h"
+#include "drivers/gpio.h"
+#include "drivers/clock.h"
+#include <stdint.h>
+#include "msp430fr2355.h"
+
+// private variables
+// frame bits of each LED, generated from the gpio.h pin map
+static const LedFrame bam_led_bits[LED_COUNT] = {LED_PIN_MAP(LED_FRAME_ENTRY)};
+
+// Plane 0 lasts a single ACLK count, too short to reschedule the compare safely, so it is timed in software
+// by the ISR that starts the frame, which then shows plane 1 straight away.
+#define BAM_LSB_CYCLES(mhz) ((mhz) * 1000000L / 32768 - 12)    // one ACLK count at an MCLK of mhz, less the plane write
+
+// ACLK counts from the compare that showed each plane to the next compare. Entry 1 covers planes 0 and 1 together.
+// A table, since the MSP430 shifts one bit per instruction.
+static const uint8_t bam_hold_counts[BAM_BITS] = {1, 3, 4, 8, 16, 32, 64, 128};
+
+// double-buffered port masks, one per bit plane. The ISR shows bam_front and swaps to bam_next at a frame start.
+static LedFrame bam_planes[2][BAM_BITS] = {{{0}}};
+static LedFrame *volatile bam_front = bam_planes[0];
+static LedFrame *volatile bam_next = 0;
+static volatile uint8_t bam_plane = 0;
+static uint8_t bam_running = 0;
+
+void init_bam(void)
+{
+    uint8_t plane;
+
+    // start dark: the first frame shows before any levels are queued
+    for (plane = 0; plane < BAM_BITS; plane++)
+    {
+        bam_planes[0][plane].p1_out = 0;
+        bam_planes[0][plane].p3_out = 0;
+    }
+    bam_front = bam_planes[0];
+    bam_next = 0;
+    bam_plane = 0;
+
+    TB2CCR0 = 1;
+    TB2CCTL0 = CCIE;
+    TB2CTL = TBSSEL__ACLK | MC__CONTINUOUS | TBCLR;  // free-running, CCR0 moved on by each plane
+    bam_running = 1;
+}
+
+void bam_stop(void)
+{
+    LedFrame off = {0, 0};
+
+    TB2CTL = TBSSEL__ACLK | MC__STOP;
+    TB2CCTL0 = 0;
+    bam_running = 0;
+    write_led_frame(&off);
+}
+
+void bam_set_levels(const uint8_t *levels)
+{
+    LedFrame *planes;
+    uint8_t led;
+    uint8_t plane;
+
+    if (!bam_running)
+    {
+        init_bam();
+    }
+
+    // withdraw the queued buffer first, so the ISR cannot swap to it while it is rewritten
+    bam_next = 0;
+    planes = (bam_front == bam_planes[0]) ? bam_planes[1] : bam_planes[0];
+
+    for (plane = 0; plane < BAM_BITS; plane++)
+    {
+        planes[plane].p1_out = 0;
+        planes[plane].p3_out = 0;
+    }
+
+    // transpose: bit n of each level goes into plane n
+    for (led = 0; led < LED_COUNT; led++)
+    {
+        const LedFrame *bits = &bam_led_bits[led];
+        uint8_t level = levels[led];
+        LedFrame *p = planes;
+
+        for (; level; level >>= 1, p++)
+        {
+            if (level & 1)
+            {
+                p->p1_out |= bits->p1_out;
+                p->p3_out |= bits->p3_out;
+            }
+        }
+    }
+
+    bam_next = planes;
+}
+
+/* -------------------------------------
+//      Interrupts
+----------------------------------------*/
+#pragma vector = TIMER2_B0_VECTOR
+/**
+ * @brief Timer_B2 CCR0 interrupt service routine that shows the next bit plane and schedules the one after.
+ * @ingroup BAM_DRIVER
+ * @note This is an internal helper; it is not exposed in the public header.
+ *       The main loop is not woken, the CPU goes straight back to LPM.
+ */
+__interrupt void Timer2_B0_ISR(void)
+{
+    uint8_t plane = bam_plane;
+    uint8_t hold;
+    uint16_t next;
+
+    if (plane == 0)
+    {
+        // frame start: pick up queued levels, then show plane 0 for one count and fall through to plane 1
+        if (bam_next)
+        {
+            bam_front = bam_next;
+            bam_next = 0;
+        }
+        write_led_frame(&bam_front[0]);
+        if (clock_in_burst())
+        {
+            __delay_cycles(BAM_LSB_CYCLES(MCLK_BURST_MHZ));    // arrived during a main loop burst
+        }
+        else
+        {
+            __delay_cycles(BAM_LSB_CYCLES(MCLK_FREQ_MHZ));
+        }
+        plane = 1;
+    }
+    write_led_frame(&bam_front[plane]);
+
+    hold = bam_hold_counts[plane];
+    next = TB2CCR0 + hold;
+    if ((uint16_t)(next - TB2R - 2) > (uint16_t)(hold - 2))
+    {
+        // held off by another interrupt until the next compare is less than two counts away, or already passed:
+        // end the plane two counts from now rather than wait a whole timer wrap
+        next = TB2R + 2;
+    }
+    TB2CCR0 = next;
+
+    bam_plane = (plane + 1) & (BAM_BITS - 1);
+}
@@ -0,0 +1,47 @@
+/**
+ * @file bam.h
+ * @brief Timer_B2 bit-angle modulation of all nine LEDs from per-bit-plane port masks.
+ */
+
+#ifndef BAM_H
+#define BAM_H
+
+#include <stdint.h>
+#include "drivers/gpio.h"
+
+/**
+ * @defgroup BAM_DRIVER Bit-angle modulation driver
+ * @brief Timer_B2 bit-angle modulation of all nine LEDs from per-bit-plane port masks.
+ * @{
+ */
+
+// Each LED level is split into BAM_BITS bit planes. Plane n is shown for 2^n ACLK counts,
+// so the lowest plane lasts one count (30.5 us) and a frame is BAM_LEVELS counts (7.8 ms, 128 Hz).
+#define BAM_BITS            8
+#define BAM_LEVELS          ((1u << BAM_BITS) - 1u)     // level 255 = on for the whole frame
+
+/**
+ * @brief Start Timer_B2 from ACLK and begin showing frames, with every LED off.
+ * @ingroup BAM_DRIVER
+ * @note TB2 keeps running in LPM3. Its compare interrupt writes one plane per bit and never wakes the main loop.
+ */
+void init_bam(void);
+
+/**
+ * @brief Queue new LED levels, shown from the start of the next frame.
+ * @ingroup BAM_DRIVER
+ * @param levels Level of each LED, LED_COUNT entries in LED number order. 0 = off, BAM_LEVELS = fully on.
+ * @note The levels are split into bit planes in the back buffer; the frame being shown is never touched,
+ *       so a frame is never torn. Calling again before the next frame starts replaces the queued levels.
+ */
+void bam_set_levels(const uint8_t *levels);
+
+/**
+ * @brief Stop Timer_B2 and turn every LED off.
+ * @ingroup BAM_DRIVER
+ * @note The next bam_set_levels() starts the timer again.
+ */
+void bam_stop(void);
+
+/** @} */
+#endif //BAM_H
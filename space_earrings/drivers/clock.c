@@ -1,28 +1,32 @@
 /**
  * @file clock.c
- * @brief System clock setup and 1 ms / 1 s tick timers.
+ * @brief System clock setup, the 1 ms tick timer and the task timer.
  * @ingroup CLOCK_DRIVER
  */
 
 #include "drivers/clock.h"
+#include "drivers/event_queue.h"
 #include <stdint.h>
 #include "msp430fr2355.h"
 
 // private variable declerations
-static volatile uint8_t timer_1ms_flag = 0;
-static volatile uint8_t timer_1s_flag = 0;
+static volatile uint8_t timer_1ms_count = 0;   // ticks not yet handled by the main loop
+static uint8_t deadline_mode = 0;               // TB0 free-running, moved on by millis_timer_set_deadline()
+static uint16_t tick_deadline = 0;              // in deadline mode, the compare value of the tick being handled
+static uint8_t xt1_state = XT1_STARTING;
 
 // private function decleration
 void xtal_init();
-void timer_1ms_flag_set();
-void timer_1s_flag_set();
+uint8_t timer_1ms_count_increment();
 void enable_millis_timer();
-void enable_second_timer();
+void enable_task_timer();
 
 /**
  * @brief Configure the crystal oscillator and basic clock sources.
  * @ingroup CLOCK_DRIVER
  * @note This is a private function.
+ *       Starts the crystal but does not wait for it: ACLK and the FLL run from REFO until clock_xt1_poll() sees it
+ *       stable, so the timers and the animation start straight away.
  */
 void xtal_init()
 {
@@ -30,34 +34,41 @@ void xtal_init()
     WDTCTL = WDTPW | WDTHOLD;               // Stop watchdog timer
 
     P2SEL1 |= BIT6 | BIT7;                  // P2.6~P2.7: crystal pins
-
-    do
-    {
-        CSCTL7 &= ~(XT1OFFG | DCOFFG);      // Clear XT1 and DCO fault flag
-        SFRIFG1 &= ~OFIFG;
-    }while (SFRIFG1 & OFIFG);               // Test oscillator fault flag
+    CSCTL6 &= ~XT1AUTOOFF;                  // nothing selects XT1 yet, so request it: it starts up from here
 
 
     //  f(DCOCLK) = 2^FLLD * (FLLN+1) * (fFLLREFCLK / n).
-    //  FLLD = 0, FLLN =62, n=1, DIVM =1, 
-    //  f(DCOCLK) = 2^0 * (62+1)*32768Hz = 2MHz,
-    //  f(DCODIV) = (62+1)*32768Hz = 2MHz,
-    //  ACLK = XT1 = ~32768Hz, SMCLK = MCLK = f(DCODIV) = 2MHz.
+    //  FLLD = 0, FLLN =121, n=1, DIVM =1, 
+    //  f(DCOCLK) = 2^0 * (121+1)*32768Hz = 4MHz,
+    //  f(DCODIV) = (121+1)*32768Hz = 4MHz,
+    //  ACLK = REFO = ~32768Hz until XT1 is stable, SMCLK = MCLK = f(DCODIV) = 4MHz.
     // Software trimming not used here, since an accurate clock is not needed. 
+    // With CLOCK_RACE_TO_IDLE the DCO runs at 16 MHz (FLLN = 487) and MCLK / SMCLK are divided down to 4 MHz,
+    // so clock_burst() only has to change the dividers.
 
     __bis_SR_register(SCG0);                                   // Disable FLL before adjusting
-    CSCTL3 = SELREF__XT1CLK;                                        // Set XT1 as FLL reference source - see Table3-7 in user guide
+#if CLOCK_POLICY == CLOCK_RACE_TO_IDLE
+    CSCTL5 = DIVM__4 | DIVS__1;                                     // MCLK = SMCLK = 4MHz until the first burst: the
+                                                                    // divider is in place before the DCO reaches 16MHz
+#else
+    CSCTL5 &= ~ (DIVS0 | DIVS1);
+#endif
+    CSCTL3 = SELREF__REFOCLK;                                       // REFO as FLL reference source until XT1 is stable - see Table3-7 in user guide
     //CSCTL1 = DCOFTRIMEN_1 | DCOFTRIM0 | DCOFTRIM1 | DCORSEL_1;      // DCOFTRIM=3, DCO Range = 4MHz
     //CSCTL2 = FLLD_0 + 62;                                           // DCODIV = 2MHz
 
+#if CLOCK_POLICY == CLOCK_RACE_TO_IDLE
+    CSCTL1 = DCOFTRIMEN_1 | DCOFTRIM_6 | DCORSEL_5;                 // DCOFTRIM=6, DCO Range = 16MHz
+    CSCTL2 = FLLD_0 + 487;                                           // DCODIV = 16MHz
+#else
     CSCTL1 = DCOFTRIMEN_1 | DCOFTRIM_6 | DCORSEL_1;                 // DCOFTRIM=6, DCO Range = 4MHz
     CSCTL2 = FLLD_0 + 121;                                           // DCODIV = 4MHz
+#endif
     __delay_cycles(3);
     __bic_SR_register(SCG0);                                    // Enable FLL after adjusting
     CSCTL0 = 256;                                                    // mid range DCO setting
-    CSCTL5 &= ~ (DIVS0 | DIVS1);
     
-    CSCTL4 = SELMS__DCOCLKDIV | SELA__XT1CLK;  // set ACLK = XT1CLK = 32768Hz
+    CSCTL4 = SELMS__DCOCLKDIV | SELA__REFOCLK; // set ACLK = REFOCLK = 32768Hz, XT1CLK once it is stable
                                                // DCOCLK = MCLK and SMCLK source
 
     // turn on the SMCLK debug output
@@ -75,7 +86,40 @@ void clock_init()
 {
     xtal_init();
     enable_millis_timer();
-    enable_second_timer();
+    enable_task_timer();
+}
+
+
+uint8_t clock_xt1_poll(void)
+{
+    if (xt1_state != XT1_STARTING)
+    {
+        return xt1_state;
+    }
+
+    CSCTL7 &= ~(XT1OFFG | DCOFFG);          // Clear XT1 and DCO fault flag
+    SFRIFG1 &= ~OFIFG;
+    if (SFRIFG1 & OFIFG)                    // still faulting: the crystal has not started yet
+    {
+        return XT1_STARTING;
+    }
+
+    // both are 32768 Hz, so the timers and the DCO carry on at the same rate
+    CSCTL3 = SELREF__XT1CLK;                // Set XT1 as FLL reference source
+    CSCTL4 = SELMS__DCOCLKDIV | SELA__XT1CLK;
+    CSCTL6 |= XT1AUTOOFF;                   // ACLK and the FLL request it now
+    xt1_state = XT1_RUNNING;
+    return xt1_state;
+}
+
+void clock_xt1_abandon(void)
+{
+    if (xt1_state == XT1_STARTING)
+    {
+        CSCTL6 |= XT1AUTOOFF;               // no longer requested, so XT1 turns off
+        P2SEL1 &= ~(BIT6 | BIT7);           // stop driving the crystal; ACLK and the FLL stay on REFO
+        xt1_state = XT1_FAILED;
+    }
 }
 
 
@@ -91,7 +135,7 @@ void enable_millis_timer()
 {
     TB0CCTL0 |= CCIE; // TBCCR0 interrupt enabled
     //32.768 = ~1ms, 32768 = 1s, 0.5ms = 16
-    TB0CCR0 = 16;
+    TB0CCR0 = TICK_ACLK_COUNTS - 1; // up mode counts 0..CCR0
     TB0CTL = TBSSEL__ACLK | MC__UP; // ACLK, UP mode
     
     // enable debug output for 1ms timer.
@@ -100,63 +144,102 @@ void enable_millis_timer()
 }
 
 /**
- * @brief Set the 1 ms tick flag from the timer ISR.
+ * @brief Count a 1 ms tick from the timer ISR.
  * @ingroup CLOCK_DRIVER
+ * @return Returns 1 if this is the first pending tick, which needs an EVENT_TICK; later ones ride on that event.
  * @note This is an internal helper; it is not exposed in the public header.
+ *       Saturates, so a long stall reads as 255 pending ticks rather than wrapping to 0.
  */
-void timer_1ms_flag_set()
+uint8_t timer_1ms_count_increment()
 {
-    timer_1ms_flag = 1;
+    if (timer_1ms_count != 0xFF)
+    {
+        timer_1ms_count += 1;
+    }
+    return timer_1ms_count == 1;
 }
 
-uint8_t timer_1ms_flag_get()
+RAMFUNC uint8_t timer_1ms_count_take(void)
 {
-    return timer_1ms_flag;
+    uint8_t count;
+
+    __disable_interrupt();
+    count = timer_1ms_count;
+    timer_1ms_count = 0;
+    __enable_interrupt();
+    return count;
 }
 
-void timer_1ms_flag_reset(void)
+uint16_t millis_timer_latency(void)
 {
-    timer_1ms_flag = 0;
+    if (deadline_mode)
+    {
+        return TB0R - tick_deadline;
+    }
+    // up mode: the count restarts from 0 on the count after the CCR0 match
+    return TB0R + 1;
+}
+
+void millis_timer_set_deadline(uint16_t ticks)
+{
+    uint16_t counts = ticks * TICK_ACLK_COUNTS;
+    uint16_t deadline;
+
+    if (!deadline_mode)
+    {
+        // first deadline: let TB0 free-run so CCR0 can be moved on without touching the period
+        TB0CTL = TBSSEL__ACLK | MC__CONTINUOUS | TBCLR;
+        deadline_mode = 1;
+        tick_deadline = 0;
+        deadline = counts;
+    }
+    else
+    {
+        tick_deadline = TB0CCR0;
+        deadline = tick_deadline + counts;
+        if ((uint16_t)(deadline - TB0R) > counts)
+        {
+            // the count already passed the deadline while the last one was handled
+            deadline = TB0R + TICK_ACLK_COUNTS;
+        }
+    }
+    TB0CCR0 = deadline;
+}
+
+void millis_timer_set_period(uint16_t ticks)
+{
+    TB0CCR0 = ticks * TICK_ACLK_COUNTS - 1; // up mode counts 0..CCR0
+    TB0CTL |= TBCLR;
 }
 
 
 /* -------------------------------------
-//      seconds timer
+//      task timer
 ----------------------------------------*/
 /**
- * @brief Configure and enable the hardware timer that generates a 1 s system tick.
+ * @brief Configure and enable the free-running timer that wakes the task scheduler.
  * @ingroup CLOCK_DRIVER
  * @note This is an internal helper; it is not exposed in the public header.
  */
-void enable_second_timer()
+void enable_task_timer()
 {
     TB1CCTL0 |= CCIE; // TBCCR0 interrupt enabled
     //32.768 = ~1ms, 32768 = 1s, 0.5ms = 16
-    TB1CCR0 = 32768;
-    TB1CTL = TBSSEL__ACLK | MC__UP; // ACLK, UP mode
+    TB1CCR0 = 1;      // first scheduler pass straight after start-up, then wherever task_timer_wake_in() puts it
+    TB1CTL = TBSSEL__ACLK | MC__CONTINUOUS | TBCLR; // ACLK, continuous mode, so TB1R is also the scheduler's clock
     
-    // enable debug output for 1s timer. - debug only! uncomment when not in use
+    // enable debug output for task timer. - debug only! uncomment when not in use
     P6DIR |= BIT6;
 }
 
-/**
- * @brief Set the 1 s tick flag from the timer ISR.
- * @ingroup CLOCK_DRIVER
- * @note This is an internal helper; it is not exposed in the public header.
- */
-void timer_1s_flag_set()
+uint16_t task_timer_now(void)
 {
-    timer_1s_flag = 1;
+    return TB1R;
 }
 
-uint8_t timer_1s_flag_get()
+void task_timer_wake_in(uint16_t counts)
 {
-    return timer_1s_flag;
-}
-
-void timer_1s_flag_reset(void)
-{
-    timer_1s_flag = 0;
+    TB1CCR0 = TB1R + counts;
 }
 
 /* -------------------------------------
@@ -174,20 +257,23 @@ void timer_1s_flag_reset(void)
 __interrupt void Timer0_B0_ISR (void)
 {
     P3OUT ^= BIT0;
-    timer_1ms_flag_set(); // flag for main loop.
-    __bic_SR_register_on_exit(LPM0_bits); // wakeup main CPU
+    if (timer_1ms_count_increment()) // count for main loop.
+    {
+        event_post(EVENT_TICK);
+    }
+    __bic_SR_register_on_exit(LPM3_bits); // wakeup main CPU
 }
 
 // Timer1_B0 interrupt service routine
 #pragma vector = TIMER1_B0_VECTOR
 /**
- * @brief Timer interrupt service routine used to generate periodic ticks for the application.
+ * @brief Timer interrupt service routine used to wake the task scheduler at its next release.
  * @ingroup CLOCK_DRIVER
  * @note This is an internal helper; it is not exposed in the public header.
  */
 __interrupt void Timer1_B0_ISR (void)
 {
     P6OUT ^= BIT6;
-    timer_1s_flag_set(); // flag for main loop.
-    __bic_SR_register_on_exit(LPM0_bits); // wakeup main CPU
+    event_post(EVENT_DEADLINE); // event for main loop.
+    __bic_SR_register_on_exit(LPM3_bits); // wakeup main CPU
 }
@@ -11,53 +11,174 @@
 #define CLOCK_H
 
 #include <stdint.h>
+#include "msp430fr2355.h"
 
 /**
  * @defgroup CLOCK_DRIVER Clock and timers
- * @brief System clock setup and 1 ms / 1 s tick timers.
+ * @brief System clock setup, the 1 ms tick timer and the task timer.
  * @{
  */
 
-#define MCLK_FREQ_MHZ  2 //clock frequency in MHz
+// clock policies, for CLOCK_POLICY
+#define CLOCK_FIXED             0   // MCLK stays at MCLK_FREQ_MHZ
+#define CLOCK_RACE_TO_IDLE      1   // MCLK at MCLK_BURST_MHZ while the main loop works, MCLK_FREQ_MHZ otherwise
+
+#ifndef CLOCK_POLICY
+#define CLOCK_POLICY            CLOCK_FIXED
+#endif
+
+#define MCLK_FREQ_MHZ  4 //clock frequency in MHz - also SMCLK, and MCLK whenever the main loop is not in a burst
+
+#if CLOCK_POLICY == CLOCK_RACE_TO_IDLE
+#define MCLK_BURST_MHZ          16  // DCO frequency, and MCLK in a burst: DCOCLKDIV / 1 with one FRAM wait state
+#else
+#define MCLK_BURST_MHZ          MCLK_FREQ_MHZ
+#endif
+
+// Code on the animation tick path is marked RAMFUNC. With CLOCK_RACE_TO_IDLE it is linked to run from RAM
+// (.TI.ramfunc, copied there at boot), so a burst does not stall on the FRAM wait state.
+#ifndef RAMFUNC_ATTRIBUTE
+#define RAMFUNC_ATTRIBUTE       __attribute__((ramfunc))
+#endif
+#if CLOCK_POLICY == CLOCK_RACE_TO_IDLE
+#define RAMFUNC                 RAMFUNC_ATTRIBUTE
+#else
+#define RAMFUNC
+#endif
 
 // port 2
 #define XOUT        BIT6
 #define XIN         BIT7
 
-#define DELAY_US(X) (__delay_cycles(X*MCLK_FREQ_MHZ))
+#define DELAY_US(X) (__delay_cycles((X)*MCLK_BURST_MHZ))   // at least X us, whichever MCLK is in effect
+
+#define TICK_ACLK_COUNTS    17 // ACLK counts per 0.5 ms tick (TB0CCR0 = 16, up mode)
+#define TASK_TIMER_HZ       32768u  // task timer counts per second: TB1 free-runs from ACLK
+
+// XT1 crystal state, from clock_xt1_poll()
+#define XT1_STARTING        0   // still faulting; ACLK and the FLL run from REFO
+#define XT1_RUNNING         1   // stable; ACLK and the FLL have been switched to it
+#define XT1_FAILED          2   // given up with clock_xt1_abandon(); REFO for good
 
 /**
  * @brief Set up the system clocks and DCO to run at MCLK_FREQ_MHZ.
  * @ingroup CLOCK_DRIVER
  * @note software trim not used, as precise clock is not required. 
+ *       Does not wait for the XT1 crystal, which can take hundreds of ms to start: ACLK and the FLL start on REFO,
+ *       and clock_xt1_poll() moves them over once it is stable.
  */
 void clock_init(void);
 
 /**
- * @brief Return the 1 ms tick flag value used by the main loop.
+ * @brief Switch ACLK and the FLL reference to XT1 if it has started.
+ * @ingroup CLOCK_DRIVER
+ * @return Returns XT1_STARTING, XT1_RUNNING or XT1_FAILED.
+ * @note Clears the oscillator fault flags once and returns straight away, so call it periodically until it stops
+ *       returning XT1_STARTING. Should XT1 fail later, the clock system falls back to REFO by itself.
+ */
+uint8_t clock_xt1_poll(void);
+
+/**
+ * @brief Give up on a crystal that has not started, and stay on REFO.
+ * @ingroup CLOCK_DRIVER
+ * @note Releases the crystal pins. No effect once XT1 is running.
+ */
+void clock_xt1_abandon(void);
+
+/**
+ * @brief Run MCLK at MCLK_BURST_MHZ, for the main loop's work between two sleeps.
+ * @ingroup CLOCK_DRIVER
+ * @note With CLOCK_RACE_TO_IDLE, sets the FRAM wait state before the divider drops to 1 and moves the SMCLK divider
+ *       the other way, so SMCLK stays at MCLK_FREQ_MHZ. Takes effect at once, since the DCO already runs at the
+ *       burst frequency; nothing to do with CLOCK_FIXED.
+ */
+static inline void clock_burst(void)
+{
+#if CLOCK_POLICY == CLOCK_RACE_TO_IDLE
+    FRCTL0 = FRCTLPW | NWAITS_1;            // FRAM needs a wait state above 8 MHz
+    CSCTL5 = DIVM__1 | DIVS__4;
+#endif
+}
+
+/**
+ * @brief Bring MCLK back to MCLK_FREQ_MHZ, before the main loop sleeps.
+ * @ingroup CLOCK_DRIVER
+ * @note The interrupts that wake the CPU, and those that never wake the main loop, then run at the speed they were
+ *       written for; the FRAM wait state is dropped again after the divider.
+ */
+static inline void clock_idle(void)
+{
+#if CLOCK_POLICY == CLOCK_RACE_TO_IDLE
+    CSCTL5 = DIVM__4 | DIVS__1;
+    FRCTL0 = FRCTLPW | NWAITS_0;
+#endif
+}
+
+/**
+ * @brief Tell whether MCLK is in a burst.
+ * @ingroup CLOCK_DRIVER
+ * @return Returns 1 while MCLK runs at MCLK_BURST_MHZ, for the few places that time themselves in MCLK cycles.
+ *         Always 0 with CLOCK_FIXED.
+ */
+static inline uint8_t clock_in_burst(void)
+{
+#if CLOCK_POLICY == CLOCK_RACE_TO_IDLE
+    return (CSCTL5 & DIVM) == DIVM__1;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Clear the pending 1 ms tick count once the tick has been handled.
+ * @ingroup CLOCK_DRIVER
+ * @return Returns the count that was pending, read and cleared with interrupts disabled. Above 1 = ticks have been missed.
+ * @note The timer ISR posts EVENT_TICK when the count leaves 0, so a tick that arrives while one is being handled
+ *       is counted here rather than queued again.
+ */
+uint8_t timer_1ms_count_take(void);
+
+/**
+ * @brief ACLK counts from the timer event of the tick being handled to now, sampled from TB0R.
+ * @ingroup CLOCK_DRIVER
+ * @return Returns latency in ACLK counts. In the fixed tick this wraps every tick, so a missed tick shows up in the count instead.
+ * @note In deadline mode, call after millis_timer_set_deadline() in the same handler.
+ */
+uint16_t millis_timer_latency(void);
+
+/**
+ * @brief Switch the tick timer to deadline mode and schedule its next interrupt.
  * @ingroup CLOCK_DRIVER
- * @return Returns flag value.
+ * @param ticks Ticks from the previous deadline to the next one, at most 65535 / TICK_ACLK_COUNTS.
+ * @note The first call puts TB0 in continuous mode and counts from the call. After that each deadline is set from
+ *       the previous one, so the schedule does not drift; a deadline that has already passed becomes one tick from now.
+ *       The 1 ms tick count then counts reached deadlines instead of fixed ticks.
  */
-uint8_t timer_1ms_flag_get(void);
+void millis_timer_set_deadline(uint16_t ticks);
 
 /**
- * @brief Clear the 1 ms tick flag once it has been handled.
+ * @brief Stretch the fixed tick to a whole number of 0.5 ms ticks.
  * @ingroup CLOCK_DRIVER
+ * @param ticks Ticks per interrupt, at most 65536 / TICK_ACLK_COUNTS.
+ * @note For output backends that do not need the main loop every 0.5 ms. Stays in up mode and restarts the count;
+ *       do not mix with millis_timer_set_deadline().
  */
-void timer_1ms_flag_reset(void);
+void millis_timer_set_period(uint16_t ticks);
 
 /**
- * @brief Return the 1 s tick flag value used by the main loop.
+ * @brief Read the free-running task timer.
  * @ingroup CLOCK_DRIVER
- * @return Returns flag value.
+ * @return Returns TB1R, in ACLK counts. Wraps every 2 s, so only differences of under 2 s mean anything.
  */
-uint8_t timer_1s_flag_get(void);
+uint16_t task_timer_now(void);
 
 /**
- * @brief Clear the 1 s tick flag once it has been handled.
+ * @brief Schedule the next task timer interrupt.
  * @ingroup CLOCK_DRIVER
+ * @param counts ACLK counts from now, 1 to 65535. The interrupt posts EVENT_DEADLINE.
+ * @note Replaces any wakeup set before. The first one, at start-up, is straight after clock_init().
  */
-void timer_1s_flag_reset(void);
+void task_timer_wake_in(uint16_t counts);
 
 /** @} */
 #endif //CLOCK_H
@@ -0,0 +1,52 @@
+/**
+ * @file event_queue.c
+ * @brief Interrupt-to-main-loop event ring and handler dispatch.
+ * @ingroup EVENT_QUEUE
+ */
+
+#include "drivers/event_queue.h"
+#include "drivers/clock.h"
+#include <stdint.h>
+
+#define EVENT_QUEUE_MASK    (EVENT_QUEUE_SIZE - 1)
+
+_Static_assert((EVENT_QUEUE_SIZE & EVENT_QUEUE_MASK) == 0, "EVENT_QUEUE_SIZE must be a power of two");
+
+EventQueueStats event_queue_stats = {0};
+
+// ring indices, read by the inline event_pending()
+volatile uint8_t event_head = 0;    // next slot to write; written by ISRs only
+volatile uint8_t event_tail = 0;    // next slot to read; written by the main loop only
+
+// private variables
+static volatile Event event_ring[EVENT_QUEUE_SIZE];
+
+void event_post(Event event)
+{
+    uint8_t head = event_head;
+    uint8_t next = (head + 1) & EVENT_QUEUE_MASK;
+
+    // the last free slot is kept for EVENT_TICK: there is only ever one in the ring, and losing it would stop the
+    // animation, since timer_1ms_count_take() is what lets the next one be posted
+    if (next == event_tail || (event != EVENT_TICK && ((next + 1) & EVENT_QUEUE_MASK) == event_tail))
+    {
+        event_queue_stats.lost += 1;
+        return;
+    }
+    event_ring[head] = event;
+    event_head = next;  // publish after the slot is written
+}
+
+RAMFUNC void event_dispatch(const EventHandler handlers[EVENT_COUNT])
+{
+    uint8_t tail = event_tail;
+
+    while (tail != event_head)
+    {
+        Event event = event_ring[tail];
+        tail = (tail + 1) & EVENT_QUEUE_MASK;
+        event_tail = tail;  // free the slot before the handler, which may take a while
+
+        handlers[event]();
+    }
+}
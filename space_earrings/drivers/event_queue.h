@@ -0,0 +1,74 @@
+/**
+ * @file event_queue.h
+ * @brief Interrupt-to-main-loop event ring and handler dispatch.
+ */
+
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include <stdint.h>
+
+/**
+ * @defgroup EVENT_QUEUE Event queue
+ * @brief Interrupt-to-main-loop event ring and handler dispatch.
+ * @{
+ */
+
+// events - one per interrupt source that needs the main loop
+#define EVENT_NONE          0
+#define EVENT_TICK          1   // Timer0_B0_ISR: animation tick due. Posted once per run of pending ticks, see timer_1ms_count_take()
+#define EVENT_DEADLINE      2   // Timer1_B0_ISR: the task scheduler's next release is due
+#define EVENT_ADC_READY     3   // ADC_ISR: a battery measurement has finished
+#define EVENT_COMP_EDGE     4   // ECOMP1_ISR: comparator output edge during a light measurement
+#define EVENT_SWITCH        5   // Port_4_ISR: SW1 pressed
+#define EVENT_COUNT         6
+
+#define EVENT_QUEUE_SIZE    8   // power of two; one slot stays empty to tell full from empty, and one is kept for EVENT_TICK
+
+typedef uint8_t Event;
+
+/** Handler for one event, called from event_dispatch() in the main loop. */
+typedef void (*EventHandler)(void);
+
+/** Queue statistics, read back by a debugger or the host simulator. */
+typedef struct
+{
+    uint16_t lost;      // events dropped because the ring was full
+} EventQueueStats;
+
+extern EventQueueStats event_queue_stats;
+extern volatile uint8_t event_head;
+extern volatile uint8_t event_tail;
+
+/**
+ * @brief Queue an event for the main loop.
+ * @ingroup EVENT_QUEUE
+ * @param event EVENT_x to post.
+ * @note ISR context only. Interrupts do not nest, so every ISR together is the single producer and the ring needs no
+ *       lock. The ISR must still clear LPM3_bits on exit to wake the main loop.
+ * @note A full ring drops the event and counts it in event_queue_stats.lost. Other events cannot take the last free
+ *       slot, so EVENT_TICK, of which there is at most one in the ring, is never dropped.
+ */
+void event_post(Event event);
+
+/**
+ * @brief Check whether any event is waiting.
+ * @ingroup EVENT_QUEUE
+ * @return Non-zero while the ring is not empty.
+ * @note Call with interrupts disabled before going to sleep, so an event posted in between is not slept through.
+ */
+static inline uint8_t event_pending(void)
+{
+    return event_head != event_tail;
+}
+
+/**
+ * @brief Run the handler of every waiting event, oldest first, until the ring is empty.
+ * @ingroup EVENT_QUEUE
+ * @param handlers Table of EVENT_COUNT handlers indexed by event. Every event that is posted needs one; EVENT_NONE is never posted.
+ * @note Main loop only - the single consumer. Costs one handler call per waiting event, whatever the number of sources.
+ */
+void event_dispatch(const EventHandler handlers[EVENT_COUNT]);
+
+/** @} */
+#endif //EVENT_QUEUE_H
@@ -5,22 +5,24 @@
  */
 
 #include "drivers/gpio.h"
+#include "drivers/event_queue.h"
+#include "drivers/clock.h"
 
-// private variable declerations
-static volatile uint8_t switch_flag = 0;
-
-// private functions
-void set_switch_flag(void);
+// The generated pin map must match the schematic pin lists, one port at a time.
+_Static_assert(LED_COUNT == 9, "LED_PIN_MAP must list all 9 LEDs");
+_Static_assert(LED_PORT1_MASK == (LED1 | LED2 | LED6 | LED7 | LED8 | LED9), "LED_PORT1_MASK does not match the schematic");
+_Static_assert(LED_PORT3_MASK == (LED3 | LED4 | LED5), "LED_PORT3_MASK does not match the schematic");
+_Static_assert((LED_PORT1_MASK & LOW_BATT_LED) == 0, "LOW_BATT_LED must stay out of the frame masks");
 
  void init_gpios()
  {
     // configure LEDs as outputs.
-    P1DIR |= (LOW_BATT_LED | LED1 | LED2 | LED6 | LED7 | LED8 | LED9);
-    P3DIR |= (LED3 | LED4 | LED5);
+    P1DIR |= (LOW_BATT_LED | LED_PORT1_MASK);
+    P3DIR |= LED_PORT3_MASK;
 
     // set initial states as low (leds off)
-    P1OUT &= ~(LOW_BATT_LED | LED1 | LED2 | LED6 | LED7 | LED8 | LED9);
-    P3OUT &= ~(LED3 | LED4 | LED5);
+    P1OUT &= ~(LOW_BATT_LED | LED_PORT1_MASK);
+    P3OUT &= ~LED_PORT3_MASK;
 
     // configure debug switch
     P4DIR &= ~SW1;
@@ -113,54 +115,40 @@ uint8_t read_gpio(uint8_t pin, uint8_t port)
     return result;
 }
 
-void turn_off_all_leds()
+RAMFUNC void write_led_frame(const LedFrame *frame)
 {
-    clear_gpio(LED1, LED1_PORT);
-    clear_gpio(LED2, LED2_PORT);
-    clear_gpio(LED3, LED3_PORT);
-    clear_gpio(LED4, LED4_PORT);
-    clear_gpio(LED5, LED5_PORT);
-    clear_gpio(LED6, LED6_PORT);
-    clear_gpio(LED7, LED7_PORT);
-    clear_gpio(LED8, LED8_PORT);
-    clear_gpio(LED9, LED9_PORT);
-
+    P1OUT = (P1OUT & ~LED_PORT1_MASK) | frame->p1_out;
+    P3OUT = (P3OUT & ~LED_PORT3_MASK) | frame->p3_out;
 }
 
-/**
- * @brief Set the software flag indicating that the user switch has been pressed.
- * @ingroup GPIO_DRIVER
- * @note This is an internal helper; it is not exposed in the public header.
- */
-void set_switch_flag()
+void turn_off_all_leds()
 {
-    switch_flag = 1;
-}
+    P1OUT &= ~LED_PORT1_MASK;
+    P3OUT &= ~LED_PORT3_MASK;
+
+    // take LED8 / LED9 back from Timer_B0 in case the timer PWM backend is driving them
+    P1SEL1 &= ~(LED8 | LED9);
 
-void clear_switch_flag()
-{
-    switch_flag = 0;
-    clear_gpio(LED9, LED9_PORT);
 }
 
-uint8_t get_switch_flag()
+void clear_switch_led()
 {
-    return switch_flag;
+    led9_off();
 }
 
 
 #pragma vector = PORT4_VECTOR
 /**
- * @brief Port 4 interrupt service routine that debounces the switch and flags the event.
+ * @brief Port 4 interrupt service routine that debounces the switch and posts the event.
  * @ingroup GPIO_DRIVER
  * @note This is an internal helper; it is not exposed in the public header.
  */
 __interrupt void Port_4_ISR(void)
 {
     if (P4IFG & BIT1) {
-        set_gpio(LED9, LED9_PORT);          // Toggle LED
+        led9_on();          // Toggle LED
         P4IFG &= ~SW1;         // Clear interrupt flag
-        set_switch_flag(); // flag for main loop.
-        __bic_SR_register_on_exit(LPM0_bits); // wakeup main CPU
+        event_post(EVENT_SWITCH); // event for main loop.
+        __bic_SR_register_on_exit(LPM3_bits); // wakeup main CPU
     }
 }
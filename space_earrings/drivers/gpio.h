@@ -56,6 +56,58 @@
 // PORT 4
 #define SW1_PORT             4
 
+/**
+ * LED pin map, in animation order: X(number, pin, port) for every animated LED.
+ * Everything that names an LED's pin or port at compile time (port masks, frame bits,
+ * the per-LED led<n>_on()/led<n>_off() routines) is generated from this one table.
+ */
+#define LED_PIN_MAP(X) \
+    X(1, LED1, LED1_PORT) \
+    X(2, LED2, LED2_PORT) \
+    X(3, LED3, LED3_PORT) \
+    X(4, LED4, LED4_PORT) \
+    X(5, LED5, LED5_PORT) \
+    X(6, LED6, LED6_PORT) \
+    X(7, LED7, LED7_PORT) \
+    X(8, LED8, LED8_PORT) \
+    X(9, LED9, LED9_PORT)
+
+#define LED_COUNT_ENTRY(num, pin, port)         + 1
+#define LED_PORT_BIT(pin, port, want)           (((port) == (want)) ? (pin) : 0)
+#define LED_PORT1_ENTRY(num, pin, port)         | LED_PORT_BIT(pin, port, 1)
+#define LED_PORT3_ENTRY(num, pin, port)         | LED_PORT_BIT(pin, port, 3)
+
+#define LED_COUNT           (0 LED_PIN_MAP(LED_COUNT_ENTRY))
+
+// LED bits of each port, for frame writes
+#define LED_PORT1_MASK      (0 LED_PIN_MAP(LED_PORT1_ENTRY))
+#define LED_PORT3_MASK      (0 LED_PIN_MAP(LED_PORT3_ENTRY))
+
+// Output register of a port given by a compile-time port number, e.g. GPIO_OUT(LED1_PORT) is P1OUT.
+// The extra level lets a port macro expand to its number before it is pasted.
+#define GPIO_OUT_(port)     P##port##OUT
+#define GPIO_OUT(port)      GPIO_OUT_(port)
+
+// Drive a pin with a compile-time pin and port: a single BIS.B / BIC.B with no port dispatch.
+#define GPIO_SET(pin, port)     (GPIO_OUT(port) |= (pin))
+#define GPIO_CLEAR(pin, port)   (GPIO_OUT(port) &= ~(pin))
+
+/** LED output levels for one animation tick, built up in locals and written with write_led_frame(). */
+typedef struct
+{
+    uint8_t p1_out;     // LED bits to drive high on port 1, within LED_PORT1_MASK
+    uint8_t p3_out;     // LED bits to drive high on port 3, within LED_PORT3_MASK
+} LedFrame;
+
+// Frame bits of one LED, as an initialiser: {P1 bit, P3 bit}
+#define LED_FRAME_ENTRY(num, pin, port)         {LED_PORT_BIT(pin, port, 1), LED_PORT_BIT(pin, port, 3)},
+
+// Per-LED set/clear routines led1_on() .. led9_off(), generated from LED_PIN_MAP.
+#define LED_INLINE_ENTRY(num, pin, port) \
+    static inline void led##num##_on(void)  { GPIO_SET(pin, port); } \
+    static inline void led##num##_off(void) { GPIO_CLEAR(pin, port); }
+LED_PIN_MAP(LED_INLINE_ENTRY)
+
 
 
 /**
@@ -90,23 +142,25 @@ void clear_gpio(uint8_t pin, uint8_t port);
 uint8_t read_gpio(uint8_t pin, uint8_t port);
 
 /**
- * @brief Turn off all LED outputs: LED1-9.
+ * @brief Drive every LED to the level in a frame, with one masked write per port.
  * @ingroup GPIO_DRIVER
+ * @param frame LED levels. LEDs whose bit is clear are turned off.
+ * @note All LED edges of the frame happen together, so LEDs on P1 and P3 change with no skew between them.
+ *       LOW_BATT_LED and the other pins of each port are left untouched.
  */
-void turn_off_all_leds(void);
+void write_led_frame(const LedFrame *frame);
 
 /**
- * @brief Clear the software switch-pressed flag.
+ * @brief Turn off all LED outputs: LED1-9.
  * @ingroup GPIO_DRIVER
  */
-void clear_switch_flag(void);
+void turn_off_all_leds(void);
 
 /**
- * @brief Return the current value of the switch-pressed flag.
+ * @brief Turn off the switch-press indicator (LED9), lit by the switch ISR, once the EVENT_SWITCH has been handled.
  * @ingroup GPIO_DRIVER
- * @return Return value as described in the detailed design.
  */
-uint8_t get_switch_flag(void);
+void clear_switch_led(void);
 
 
 /** @} */
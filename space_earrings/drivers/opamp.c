@@ -1,4 +1,5 @@
 #include "drivers/opamp.h"
+#include "drivers/event_queue.h"
 #include "msp430fr2355.h"
 #include <stdint.h>
 
@@ -66,6 +67,12 @@ void init_comp(void)
 
 }
 
+uint8_t get_comp_output(void)
+{
+    __delay_cycles(COMP_SETTLE_CYCLES);
+    return (uint8_t)(CP1CTL1 & CPOUT);
+}
+
 void enable_comp_interrupts(void)
 {
     CP1CTL1 |= CPIIE | CPIE;                   // Enable eCOMP dual edge interrupt
@@ -127,6 +134,8 @@ __interrupt void ECOMP1_ISR(void)
             break;
         case CPIV__CPIIFG: // The interrupt flag CPIIFG is set on an inverted edge of the eCOMP output (high-> low) : which is dim to bright. 
             set_comp_high_to_low();
+            event_post(EVENT_COMP_EDGE);         // the light measurement can finish now, not at the next tick
+            __bic_SR_register_on_exit(LPM3_bits); // wakeup main CPU
             break;
         default:
             break;
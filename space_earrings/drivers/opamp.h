@@ -7,6 +7,7 @@
 #define OPAMP_H
 
 #include <stdint.h>
+#include "drivers/clock.h"
 
 /**
  * @defgroup OPAMP_DRIVER Op-amp and comparator
@@ -14,6 +15,8 @@
  * @{
  */
 
+#define COMP_SETTLE_CYCLES  (5 * MCLK_BURST_MHZ)   // MCLK cycles for the DAC and the low-power comparator to settle, ~5 us at the fastest MCLK
+
 /**
  * @brief Configure the on-chip SAC / op-amp as a first-stage amplifier for the light sensor.
  * @ingroup OPAMP_DRIVER
@@ -60,6 +63,14 @@ void reset_comp_high_to_low(void);
  */
 void set_dac_multiplier(uint8_t m);
 
+/**
+ * @brief Read the comparator output level directly, once it has settled after a DAC change.
+ * @ingroup OPAMP_DRIVER
+ * @return Returns CPOUT. HIGH = DAC threshold above the light signal (dim), LOW = light signal at or above it (bright).
+ * @note Waits COMP_SETTLE_CYCLES first, so call straight after set_dac_multiplier(). Needs no comparator interrupts.
+ */
+uint8_t get_comp_output(void);
+
 /**
  * @brief Enable comparator interrupts.
  * @ingroup OPAMP_DRIVER
@@ -0,0 +1,157 @@
+/**
+ * @file pwm.c
+ * @brief Timer_B0 compare channels used as the LED PWM backend.
+ * @ingroup PWM_DRIVER
+ */
+
+#include "drivers/pwm.h"
+#include "drivers/gpio.h"
+#include <stdint.h>
+#include "msp430fr2355.h"
+
+typedef struct
+{
+    uint8_t pin;            // LED currently on this channel, 0 = none
+    uint8_t port;
+    uint8_t hardware;       // LED is on the channel's own Timer_B output pin
+    uint16_t on_counts;
+} PwmChannel;
+
+// private variables
+static PwmChannel pwm_channels[PWM_CHANNEL_COUNT] = {{0}};
+static uint16_t pwm_period = 0;
+static const uint8_t pwm_output_pin[PWM_CHANNEL_COUNT] = {LED8, LED9}; // P1.6 = TB0.1, P1.7 = TB0.2
+
+// private functions
+void set_compare(uint8_t channel, uint16_t cctl, uint16_t ccr);
+void release_channel(PwmChannel *ch);
+
+void init_pwm(uint16_t period)
+{
+    pwm_period = period;
+
+    TB0CCR0 = period - 1; // up mode counts 0..CCR0
+    set_compare(PWM_CHANNEL_1, OUTMOD_0, 0);
+    set_compare(PWM_CHANNEL_2, OUTMOD_0, 0);
+    TB0CTL |= TBCLR;
+}
+
+/**
+ * @brief Write a channel's compare value and control register.
+ * @ingroup PWM_DRIVER
+ * @param channel PWM_CHANNEL_1 or PWM_CHANNEL_2.
+ * @param cctl TB0CCTLx value. Writing it also clears a pending CCIFG.
+ * @param ccr TB0CCRx value.
+ * @note This is an internal helper; it is not exposed in the public header.
+ */
+void set_compare(uint8_t channel, uint16_t cctl, uint16_t ccr)
+{
+    // compare value first, so an enabled interrupt never sees the old one
+    if (channel == PWM_CHANNEL_1)
+    {
+        TB0CCR1 = ccr;
+        TB0CCTL1 = cctl;
+    }
+    else
+    {
+        TB0CCR2 = ccr;
+        TB0CCTL2 = cctl;
+    }
+}
+
+/**
+ * @brief Hand a channel's LED pin back to GPIO and turn the LED off.
+ * @ingroup PWM_DRIVER
+ * @param ch Channel to release.
+ * @note This is an internal helper; it is not exposed in the public header.
+ */
+void release_channel(PwmChannel *ch)
+{
+    if (ch->hardware)
+    {
+        P1SEL1 &= ~ch->pin;
+    }
+    clear_gpio(ch->pin, ch->port);
+    ch->pin = 0;
+}
+
+void pwm_set_duty(uint8_t channel, uint8_t pin, uint8_t port, uint16_t on_counts)
+{
+    PwmChannel *ch = &pwm_channels[channel - 1];
+
+    if (ch->pin && (ch->pin != pin || ch->port != port))
+    {
+        release_channel(ch);
+    }
+    ch->pin = pin;
+    ch->port = port;
+    ch->hardware = (port == 1) && (pin == pwm_output_pin[channel - 1]);
+    ch->on_counts = on_counts;
+
+    if (on_counts == 0)
+    {
+        set_compare(channel, OUTMOD_0, 0);                  // output held low, no interrupt
+    }
+    else if (on_counts >= pwm_period)
+    {
+        set_compare(channel, OUTMOD_0 | OUT, 0);            // output held high, no interrupt
+    }
+    else if (ch->hardware)
+    {
+        set_compare(channel, OUTMOD_7, on_counts);          // reset at CCRx, set at CCR0
+    }
+    else
+    {
+        set_compare(channel, CCIE, on_counts);              // compare interrupt ends the on-time
+    }
+
+    if (ch->hardware)
+    {
+        P1SEL1 |= pin;                                      // P1SEL1 = 1, P1SEL0 = 0: TB0.x output
+    }
+    else if (on_counts == 0)
+    {
+        clear_gpio(pin, port);
+    }
+    else if (on_counts >= pwm_period)
+    {
+        set_gpio(pin, port);
+    }
+}
+
+void pwm_period_start(uint8_t channel)
+{
+    PwmChannel *ch = &pwm_channels[channel - 1];
+
+    if (!ch->hardware && ch->on_counts && ch->on_counts < pwm_period)
+    {
+        set_gpio(ch->pin, ch->port);
+    }
+}
+
+/* -------------------------------------
+//      Interrupts
+----------------------------------------*/
+#pragma vector = TIMER0_B1_VECTOR
+/**
+ * @brief Timer_B0 CCR1/CCR2 interrupt service routine that ends the on-time of interrupt-switched LEDs.
+ * @ingroup PWM_DRIVER
+ * @note This is an internal helper; it is not exposed in the public header.
+ *       The main loop is not woken, the CPU goes straight back to LPM.
+ */
+__interrupt void Timer0_B1_ISR(void)
+{
+    switch(__even_in_range(TB0IV, TBIV__TBIFG))
+    {
+        case TBIV__NONE:
+            break;
+        case TBIV__TBCCR1:
+            clear_gpio(pwm_channels[0].pin, pwm_channels[0].port);
+            break;
+        case TBIV__TBCCR2:
+            clear_gpio(pwm_channels[1].pin, pwm_channels[1].port);
+            break;
+        default:
+            break;
+    }
+}
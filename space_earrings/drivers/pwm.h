@@ -0,0 +1,54 @@
+/**
+ * @file pwm.h
+ * @brief Timer_B0 compare channels used as the LED PWM backend.
+ */
+
+#ifndef PWM_H
+#define PWM_H
+
+#include <stdint.h>
+
+/**
+ * @defgroup PWM_DRIVER Timer PWM driver
+ * @brief Timer_B0 compare channels used as the LED PWM backend.
+ * @{
+ */
+
+// TB0 compare channels available for LED PWM. TB0.1 and TB0.2 come out on P1.6 (LED8) and P1.7 (LED9),
+// the only LEDs wired to a Timer_B output; any other LED given to a channel is switched by its compare interrupt.
+#define PWM_CHANNEL_COUNT   2
+#define PWM_CHANNEL_1       1   // TB0.1, P1.6
+#define PWM_CHANNEL_2       2   // TB0.2, P1.7
+
+/**
+ * @brief Set the Timer_B0 period to one PWM period and put both compare channels in a known off state.
+ * @ingroup PWM_DRIVER
+ * @param period PWM period in ACLK counts.
+ * @note TB0 keeps generating the CCR0 tick from the clock driver, so the tick becomes one PWM period.
+ *       Call after clock_init().
+ */
+void init_pwm(uint16_t period);
+
+/**
+ * @brief Assign an LED to a compare channel and set its on-time.
+ * @ingroup PWM_DRIVER
+ * @param channel PWM_CHANNEL_1 or PWM_CHANNEL_2.
+ * @param pin GPIO bit of the LED.
+ * @param port GPIO port of the LED.
+ * @param on_counts On-time in ACLK counts from the start of the period. 0 = off, >= period = always on.
+ * @note If the LED sits on the channel's own Timer_B output pin the duty is generated in hardware with no CPU wakeups.
+ *       Otherwise the compare interrupt turns the LED off and pwm_period_start() turns it back on.
+ *       Moving a channel to another LED turns the previous LED off.
+ */
+void pwm_set_duty(uint8_t channel, uint8_t pin, uint8_t port, uint16_t on_counts);
+
+/**
+ * @brief Start a new PWM period on a channel. Call once per period, straight after the CCR0 tick.
+ * @ingroup PWM_DRIVER
+ * @param channel PWM_CHANNEL_1 or PWM_CHANNEL_2.
+ * @note Only interrupt-switched LEDs need this; it does nothing for an LED on its Timer_B output pin.
+ */
+void pwm_period_start(uint8_t channel);
+
+/** @} */
+#endif //PWM_H
@@ -10,13 +10,289 @@
 #include "drivers/clock.h"
 #include "drivers/adc.h"
 #include "drivers/opamp.h"
+#include "drivers/event_queue.h"
 #include "led_control.h"
 #include "brightness_control.h"
+#include "battery_governor.h"
+#include "tick_stats.h"
+#include "moving_average.h"
+#include "resume_state.h"
 #include <stdint.h>
 
+#define BATT_LOW_COUNT      5   // readings below BATT_LOW in a row before the cutoff
+#define XT1_START_POLLS     (XT1_START_TIMEOUT_MS / CLOCK_PERIOD_MS)
+_Static_assert(XT1_START_POLLS >= 1 && XT1_START_POLLS <= 255, "XT1_START_TIMEOUT_MS: 1 to 255 clock polls");
+
 // private variables
 uint8_t batt_low_counter = 0;
 uint8_t battery_good_flag = 1;
+// for using functions within battery_control.h
+static uint8_t brightness = 255; // initial brightness setting, variable changed by photodiode measurement
+MOVING_AVERAGE(brightness_average, BRIGHTNESS_AVERAGE_SHIFT);  // ambient light over the last 8 measurements
+EXP_AVERAGE(battery_average, BATTERY_AVERAGE_SHIFT);            // battery voltage seen by the governor
+static uint8_t xt1_polls = 0;   // clock task runs while XT1 is starting
+
+// private functions
+void battery_update(uint16_t battery_voltage);
+uint8_t animation_task(Task *task);
+uint8_t light_task(Task *task);
+uint8_t battery_task(Task *task);
+uint8_t switch_task(Task *task);
+uint8_t persist_task(Task *task);
+uint8_t clock_task(Task *task);
+void on_tick(void);
+void on_deadline(void);
+void on_adc_ready(void);
+void on_comp_edge(void);
+void on_switch(void);
+
+// application tasks, indexed by TASK_x. Period 0 = released by its event handler.
+Task earrings_tasks[TASK_COUNT] = {
+    [TASK_ANIMATION] = {.body = animation_task, .period = 0,                            .deadline = TICK_ACLK_COUNTS},
+    [TASK_LIGHT]     = {.body = light_task,     .period = TASK_MS(LIGHT_PERIOD_MS),     .deadline = TASK_MS(100)},
+    [TASK_BATTERY]   = {.body = battery_task,   .period = TASK_MS(BATTERY_PERIOD_MS),   .deadline = TASK_MS(100)},
+    [TASK_SWITCH]    = {.body = switch_task,    .period = 0,                            .deadline = TASK_MS(100)},
+    [TASK_PERSIST]   = {.body = persist_task,   .period = TASK_MS(PERSIST_PERIOD_MS),   .deadline = TASK_MS(100)},
+    [TASK_CLOCK]     = {.body = clock_task,     .period = TASK_MS(CLOCK_PERIOD_MS),     .deadline = TASK_MS(100)},
+};
+
+// event handlers, indexed by EVENT_x - const, so they stay in FRAM
+static const EventHandler event_handlers[EVENT_COUNT] = {
+    0,              // EVENT_NONE
+    on_tick,        // EVENT_TICK
+    on_deadline,    // EVENT_DEADLINE
+    on_adc_ready,   // EVENT_ADC_READY
+    on_comp_edge,   // EVENT_COMP_EDGE
+    on_switch,      // EVENT_SWITCH
+};
+
+/**
+ * @brief Private function to earrings.c: act on a battery reading - low-battery cutoff, then the duty governor.
+ * @ingroup EARRINGS_APP
+ * @param battery_voltage Battery voltage in mV, from adc_to_mv().
+ * @note This is an internal helper; it is not exposed in the public header.
+ */
+void battery_update(uint16_t battery_voltage)
+{
+    // the cutoff counts raw readings itself; the governor's levels follow the smoothed voltage
+    battery_good_flag = batt_low_handler(battery_voltage);
+    governor_update(battery_average_update(battery_voltage));
+
+    if (!battery_good_flag)
+    {
+        stop_animation();
+        turn_off_all_leds();
+    }
+#if ADC_MEASURE == ADC_MEASURE_WINDOW
+    if (batt_low_counter)
+    {
+        adc_set_window(1, 0);       // every reading, so the cutoff can count them
+        if (!earrings_tasks[TASK_BATTERY].period)
+        {
+            earrings_tasks[TASK_BATTERY].period = TASK_MS(BATTERY_PERIOD_MS);
+            earrings_tasks[TASK_BATTERY].release = task_timer_now();
+        }
+    }
+    else
+    {
+        // off the schedule: the ADC watches the window itself, and a reading outside it releases the task
+        adc_set_window(governor_window_low(), governor_window_high());
+        earrings_tasks[TASK_BATTERY].period = 0;
+    }
+#endif
+}
+
+/**
+ * @brief Private function to earrings.c: TASK_ANIMATION body - advance the animation by one tick.
+ * @ingroup EARRINGS_APP
+ * @param task This task.
+ * @return PT_ENDED; every job is a single step.
+ * @note This is an internal helper; it is not exposed in the public header.
+ */
+RAMFUNC uint8_t animation_task(Task *task)
+{
+    if (battery_good_flag)
+    {
+        // three, two or one LED at a time and a brightness cap, by what the battery can afford
+        governor_run(brightness);
+    }
+#if TICK_STATS_ENABLE
+    tick_stats_record(timer_1ms_count_take(), millis_timer_latency());
+#else
+    timer_1ms_count_take();
+#endif
+    return PT_ENDED;
+}
+
+/**
+ * @brief Private function to earrings.c: TASK_LIGHT body - measure the ambient light and update the brightness.
+ * @ingroup EARRINGS_APP
+ * @param task This task.
+ * @return PT_WAITING until the measurement is done, then PT_ENDED.
+ * @note This is an internal helper; it is not exposed in the public header.
+ *       One DAC step per run, so light sensing never holds up an animation tick.
+ */
+uint8_t light_task(Task *task)
+{
+    PT_BEGIN(task);
+
+    // start a brightness measurement to adjust global brightness - comment out if photodiode not connected!
+    brightness_start();
+    do
+    {
+        PT_YIELD(task);     // resumed by the next tick or comparator edge
+        brightness_step();
+    } while (!is_brightness_ready());
+
+    brightness = get_scaled_brightness((uint8_t)brightness_average_update(get_brightness_value()));
+    clear_brightness_ready();
+
+    PT_END(task);
+}
+
+/**
+ * @brief Private function to earrings.c: TASK_BATTERY body - measure the battery and act on the reading.
+ * @ingroup EARRINGS_APP
+ * @param task This task.
+ * @return PT_WAITING until the ADC measurement has finished, then PT_ENDED.
+ * @note This is an internal helper; it is not exposed in the public header.
+ */
+uint8_t battery_task(Task *task)
+{
+    PT_BEGIN(task);
+
+    adc_start();
+    PT_WAIT_UNTIL(task, !adc_busy());   // resumed by EVENT_ADC_READY
+
+    // with ADC_MEASURE_WINDOW a reading inside the window is not reported, and there is nothing to do
+    if (is_conversion_ready())
+    {
+        battery_update(adc_to_mv(get_adc_value()));
+    }
+
+    PT_END(task);
+}
+
+/**
+ * @brief Private function to earrings.c: TASK_SWITCH body. For debug only.
+ * @ingroup EARRINGS_APP
+ * @param task This task.
+ * @return PT_ENDED.
+ * @note This is an internal helper; it is not exposed in the public header.
+ */
+uint8_t switch_task(Task *task)
+{
+    // do something here
+    // DEBUG
+
+    clear_switch_led();
+    return PT_ENDED;
+}
+
+/**
+ * @brief Private function to earrings.c: TASK_PERSIST body - snapshot the runtime state into FRAM.
+ * @ingroup EARRINGS_APP
+ * @param task This task.
+ * @return PT_ENDED.
+ * @note This is an internal helper; it is not exposed in the public header.
+ */
+uint8_t persist_task(Task *task)
+{
+    ResumeState state;
+
+    // nothing worth keeping until both filters have their first sample
+    if (!brightness_average.primed || !battery_average.primed)
+    {
+        return PT_ENDED;
+    }
+    state.iters = led_iters;
+    state.track = led_active_track;
+    state.light_average = brightness_average_value();
+    state.battery_average = battery_average_value();
+    state.batt_low_counter = batt_low_counter;
+    state.batt_cutoff = !battery_good_flag;
+    resume_state_save(&state);
+    return PT_ENDED;
+}
+
+/**
+ * @brief Private function to earrings.c: TASK_CLOCK body - move ACLK over to XT1 once it has started.
+ * @ingroup EARRINGS_APP
+ * @param task This task.
+ * @return PT_ENDED.
+ * @note This is an internal helper; it is not exposed in the public header.
+ *       The LEDs run on REFO meanwhile. Once XT1 is running, or has been given up after XT1_START_TIMEOUT_MS, the
+ *       task takes itself off the schedule.
+ */
+uint8_t clock_task(Task *task)
+{
+    if (clock_xt1_poll() == XT1_STARTING)
+    {
+        xt1_polls += 1;
+        if (xt1_polls < XT1_START_POLLS)
+        {
+            return PT_ENDED;
+        }
+        clock_xt1_abandon();
+    }
+    task->period = 0;   // never released again
+    return PT_ENDED;
+}
+
+/**
+ * @brief Private function to earrings.c: EVENT_TICK handler - release the animation and step the light measurement.
+ * @ingroup EARRINGS_APP
+ * @note This is an internal helper; it is not exposed in the public header.
+ */
+RAMFUNC void on_tick(void)
+{
+    task_release(&earrings_tasks[TASK_ANIMATION]);
+    task_run(&earrings_tasks[TASK_LIGHT]);
+}
+
+/**
+ * @brief Private function to earrings.c: EVENT_DEADLINE handler - release the periodic tasks that are due.
+ * @ingroup EARRINGS_APP
+ * @note This is an internal helper; it is not exposed in the public header.
+ */
+void on_deadline(void)
+{
+    scheduler_release_due(earrings_tasks, TASK_COUNT);
+}
+
+/**
+ * @brief Private function to earrings.c: EVENT_ADC_READY handler - resume the battery task.
+ * @ingroup EARRINGS_APP
+ * @note This is an internal helper; it is not exposed in the public header.
+ */
+void on_adc_ready(void)
+{
+#if ADC_MEASURE == ADC_MEASURE_WINDOW
+    task_release(&earrings_tasks[TASK_BATTERY]);   // also a reading outside the window, with no job waiting
+#else
+    task_run(&earrings_tasks[TASK_BATTERY]);
+#endif
+}
+
+/**
+ * @brief Private function to earrings.c: EVENT_COMP_EDGE handler - step the light measurement.
+ * @ingroup EARRINGS_APP
+ * @note This is an internal helper; it is not exposed in the public header.
+ */
+void on_comp_edge(void)
+{
+    task_run(&earrings_tasks[TASK_LIGHT]);
+}
+
+/**
+ * @brief Private function to earrings.c: EVENT_SWITCH handler - release the switch task.
+ * @ingroup EARRINGS_APP
+ * @note This is an internal helper; it is not exposed in the public header.
+ */
+void on_switch(void)
+{
+    task_release(&earrings_tasks[TASK_SWITCH]);
+}
 
 void init_earrings(void)
 {
@@ -44,63 +320,53 @@ void init_earrings(void)
     // init variables for twinkle animation
     init_twinkle();
 
+    // carry on from before the reset, rather than from full brightness and the lowest duty budget
+    resume_earrings();
 }
 
-void run_earrings(void)
+uint8_t resume_earrings(void)
 {
-    // for battery monitoring functionality
-    uint16_t battery_voltage;
+    ResumeState state;
 
-    // for using functions within battery_control.h
-    static uint8_t brightness = 255; // initial brightness setting, variable changed by photodiode measurement
-    static uint8_t brightness_ring_buff[8] = {0}; // ring buff for moving average purposes
-    static uint8_t brightness_ring_buff_iter = 0; // ring buff iterator
-
-    while(1)
+    if (!resume_state_load(&state))
     {
-        // go to sleep and wait for interrupt wakeup. 
-        __bis_SR_register(LPM0_bits | GIE);          // Enter LPM0 w/ interrupt
-        
-        // check if interrupt is the 1ms timer interrupt and we are not in low power mode.
-        if (timer_1ms_flag_get() & battery_good_flag)
-        {
-            twinkle_two(brightness);
-            timer_1ms_flag_reset();
+        return 0;
+    }
+    brightness = get_scaled_brightness((uint8_t)brightness_average_update(state.light_average));
+    governor_update(battery_average_update(state.battery_average));
+    resume_animation(&state.iters, &state.track);
 
-        }
+    // a cell that had reached the cutoff stays off until a reading says otherwise; the counter alone cannot say it
+    // had, since batt_low_handler() holds it at BATT_LOW_COUNT from the cutoff on
+    batt_low_counter = state.batt_low_counter;
+    if (state.batt_cutoff)
+    {
+        set_gpio(LOW_BATT_LED, LOW_BATT_LED_PORT);
+        battery_good_flag = 0;
+    }
+    return 1;
+}
 
-        if (timer_1s_flag_get())
+void run_earrings(void)
+{
+    while(1)
+    {
+        // go to sleep and wait for interrupt wakeup - unless an event arrived while the last pass was running,
+        // since its ISR found the CPU awake and will not wake it again.
+        __disable_interrupt();
+        if (event_pending())
         {
-            // check battery voltage input - get most recent result if ready
-            if (is_conversion_ready())
-            {
-                battery_voltage = get_adc_value();
-                battery_good_flag = batt_low_handler(battery_voltage);
-
-                if (!battery_good_flag)
-                {
-                    turn_off_all_leds();
-                }
-                timer_1s_flag_reset();
-            }
-            
-            // execute brightness check to adjust global brightness - comment out if photodiode not connected!
-            uint8_t temp_brightness = brightness_check();
-            uint8_t temp_brightness_ma = update_ma_size_8(temp_brightness, brightness_ring_buff, &brightness_ring_buff_iter);
-            brightness = get_scaled_brightness(temp_brightness_ma);
-
+            __enable_interrupt();
         }
-        //for debug only
-        if(get_switch_flag())
+        else
         {
-            // do something here
-            // DEBUG 
-           
-            // clear switch flag
-            clear_switch_flag();
+            clock_idle();                               // back to MCLK_FREQ_MHZ for the ISRs
+            __bis_SR_register(LPM3_bits | GIE);         // Enter LPM3 w/ interrupt
+            clock_burst();                              // race through the events, then straight back to sleep
         }
 
-           
+        // one handler per event that woke us, which releases or resumes the task waiting on it
+        event_dispatch(event_handlers);
     }
    
 }
@@ -118,7 +384,7 @@ uint8_t batt_low_handler(uint16_t battery_voltage)
     }
 
 
-    if (batt_low_counter > 5)
+    if (batt_low_counter > BATT_LOW_COUNT)
     {
         batt_low_counter -= 1; // to prevent this from overflowing
         set_gpio(LOW_BATT_LED, LOW_BATT_LED_PORT);
@@ -129,7 +395,6 @@ uint8_t batt_low_handler(uint16_t battery_voltage)
         battery_good = 1;
     }
     clear_conversion_ready();
-    adc_start();
     return battery_good;
 }
 
@@ -7,29 +7,75 @@
 #define EARRINGS_H
 
 #include <stdint.h>
-
+#include "task_scheduler.h"
 
 /**
  * @defgroup EARRINGS_APP Earrings application
  * @brief Top-level application loop, battery and brightness management.
  * @{
  */
+
+// application tasks, by index into earrings_tasks
+#define TASK_ANIMATION      0   // one job per animation tick, released by EVENT_TICK
+#define TASK_LIGHT          1   // ambient light measurement, one DAC step per tick or comparator edge
+#define TASK_BATTERY        2   // battery measurement and duty governor update
+#define TASK_SWITCH         3   // SW1 debug, released by EVENT_SWITCH
+#define TASK_PERSIST        4   // snapshot of the runtime state into FRAM, see resume_state.h
+#define TASK_CLOCK          5   // XT1 start-up, until ACLK is on the crystal or it has been given up
+#define TASK_COUNT          6
+
+#ifndef LIGHT_PERIOD_MS
+#define LIGHT_PERIOD_MS     1000    // ambient light measurement period, up to 1999 ms
+#endif
+#ifndef BATTERY_PERIOD_MS
+#define BATTERY_PERIOD_MS   1000    // battery measurement period, up to 1999 ms
+#endif
+#ifndef PERSIST_PERIOD_MS
+#define PERSIST_PERIOD_MS   1000    // runtime state snapshot period, up to 1999 ms; a reset resumes from up to this far back
+#endif
+
+#ifndef CLOCK_PERIOD_MS
+#define CLOCK_PERIOD_MS     100     // XT1 start-up poll period, up to 1999 ms
+#endif
+#ifndef XT1_START_TIMEOUT_MS
+#define XT1_START_TIMEOUT_MS 3000   // a crystal not stable after this long is given up, and ACLK stays on REFO
+#endif
+
+#ifndef BRIGHTNESS_AVERAGE_SHIFT
+#define BRIGHTNESS_AVERAGE_SHIFT    3   // ambient light: moving average of the last 2^3 = 8 measurements
+#endif
+#ifndef BATTERY_AVERAGE_SHIFT
+#define BATTERY_AVERAGE_SHIFT       2   // battery: exponential average, each reading moves it 1/2^2 of the way
+#endif
+
+extern Task earrings_tasks[TASK_COUNT];
+
 /**
  * @brief Initialise the earrings application, clocks, GPIOs, ADC and analog front-end.
  * @ingroup EARRINGS_APP
  */
 void init_earrings(void);
 
+/**
+ * @brief Carry on from the runtime state saved before the last reset, if there is one.
+ * @ingroup EARRINGS_APP
+ * @return 1 if a saved state was restored, 0 for a cold start.
+ * @note Called by init_earrings(). Restores the filtered brightness, the battery filter, governor level and low-battery
+ *       count, and the animation phase, so the first tick already runs at the right brightness and level.
+ */
+uint8_t resume_earrings(void);
+
 /**
  * @brief Main low-power run loop that drives animations, battery checks and brightness updates.
  * @ingroup EARRINGS_APP
+ * @note Sleeps until an event arrives and hands it to the task it releases or resumes; see earrings_tasks.
  */
 void run_earrings(void);
 
 /**
  * @brief Handle battery-low detection and update internal state and the low-battery indicator LED.
  * @ingroup EARRINGS_APP
- * @param battery_voltage ADC reading of the battery voltage in raw counts.
+ * @param battery_voltage Battery voltage in mV, from adc_to_mv(); compared against BATT_LOW.
  * @return Return value as described in the detailed design.
  */
 
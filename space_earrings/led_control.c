@@ -5,15 +5,63 @@
  */
 
 #include "led_control.h"
+#include "led_gamma.h"
 #include "drivers/gpio.h"
 
+// BAM driven straight from sine_single_led(), rather than through the LED_OUTPUT stage
+#define LED_BAM_FUSED                   ((LED_PWM_BACKEND == LED_PWM_BAM) && (LED_PIPELINE == LED_PIPELINE_FUSED))
+
+#if LED_PWM_BACKEND == LED_PWM_TIMER
+#include "drivers/pwm.h"
+#endif
+#if LED_BAM_FUSED
+#include "drivers/bam.h"
+#endif
+#include "drivers/clock.h"
+#if LED_PIPELINE == LED_PIPELINE_FRAME
+#include "led_output.h"
+#endif
+
 // private variables
-uint8_t led_list[9] = {LED1, LED2, LED3, LED4, LED5, LED6, LED7, LED8, LED9};
-uint8_t led_port_list[9] = {LED1_PORT, LED2_PORT, LED3_PORT, LED4_PORT, LED5_PORT, LED6_PORT, LED7_PORT, LED8_PORT, LED9_PORT};
+// frame bits of each LED, generated from the gpio.h pin map - const, so they stay in FRAM
+static const LedFrame led_frame_bits[LED_COUNT] = {LED_PIN_MAP(LED_FRAME_ENTRY)};
+
+#if LED_PWM_BACKEND == LED_PWM_TIMER
+// pin and port of each LED for the timer PWM backend, which drives one pin at a time
+#define LED_PIN_ENTRY(num, pin, port)   pin,
+#define LED_PORT_ENTRY(num, pin, port)  port,
+static const uint8_t led_list[LED_COUNT] = {LED_PIN_MAP(LED_PIN_ENTRY)};
+static const uint8_t led_port_list[LED_COUNT] = {LED_PIN_MAP(LED_PORT_ENTRY)};
+#endif
+
+// per-group animation state, set from the animation's start state by start_animation()
+LedIters led_iters = {{0}};
+LedActiveTracker led_active_track = {{0}};
+static const LedAnimation *current_animation = 0;
+// where the next animation to start picks up instead of its start state, set by resume_animation()
+static LedIters resume_iters = {{0}};
+static LedActiveTracker resume_track = {{0}};
+static uint8_t resume_pending = 0;
 
-// initiate iters with an offset
-LedIters led_iters = {0, 2000, 0, 0, 0, 0, 0, 0, 0};
-LedActiveTracker led_active_track = {1, 0, 1, 0, 0, 0, 0, 1, 0};
+// animation sequences - const, so they stay in FRAM. Group 2 starts half a waveform after group 1.
+static const uint8_t twinkle_two_group_1[] = {1, 4, 7, 3, 9};
+static const uint8_t twinkle_two_group_2[] = {2, 5, 8, 6};
+static const LedAnimation twinkle_two_animation = {2, {{twinkle_two_group_1, 5, 0}, {twinkle_two_group_2, 4, 2000}}};
+
+// one LED at a time. LED_PWM_TIMER needs the whole group on one compare channel, so it walks twinkle_two()'s group 1.
+#if LED_PWM_BACKEND == LED_PWM_TIMER
+static const LedAnimation twinkle_one_animation = {1, {{twinkle_two_group_1, 5, 0}}};
+#else
+static const uint8_t twinkle_one_leds[] = {1, 4, 7, 2, 5, 8, 3, 6, 9};
+static const LedAnimation twinkle_one_animation = {1, {{twinkle_one_leds, 9, 0}}};
+#endif
+
+#if LED_PWM_BACKEND != LED_PWM_TIMER
+static const uint8_t twinkle_three_group_1[] = {1, 4, 7};
+static const uint8_t twinkle_three_group_2[] = {2, 5, 8};
+static const uint8_t twinkle_three_group_3[] = {3, 6, 9};
+static const LedAnimation twinkle_three_animation = {3, {{twinkle_three_group_1, 3, 0}, {twinkle_three_group_2, 3, 2000}, {twinkle_three_group_3, 3, 0}}};
+#endif
 
 // single led function
 #define max_iter                        4000           // 2000ms per total sunsoid waveform - ORIGINAL = 2000
@@ -21,10 +69,12 @@ LedActiveTracker led_active_track = {1, 0, 1, 0, 0, 0, 0, 1, 0};
 #define max_led_blink_period_size       20             // 20ms per single LED PWM output - this means that we have (max_iter/sinusoid_size) / max_led_blink_period_size 
                                                       // = 5 waveforms per sinusoid "point". Please ensure that the equation in this comment is a whole number. ORIGINAL = 20
 
+#if LED_ENGINE == LED_ENGINE_ARITHMETIC
 // reciprocals for faster calculations - remember to >> 16 for these to work. 
 static const uint16_t max_iter_recip = (uint16_t)(65536 / max_iter); // 32u
 static const uint16_t sinusoid_size_recip = (uint16_t)(65536 / sinusoid_size); // 3276u
 static const uint16_t max_led_blink_period_size_recip = (uint16_t)(65536 / max_led_blink_period_size); // 6553u
+#endif
 
 // sine waveform of size sinusoid_size - generated by a python script
 //static const uint8_t sinusoid[sinusoid_size] = { 0, 6, 24, 53, 88, 128, 168, 203, 232, 250, 255, 250, 232, 203, 168, 128, 88, 53, 24, 6};
@@ -34,23 +84,84 @@ static const uint8_t sinusoid[sinusoid_size] = {0,16,32,48,63,79,94,109,123,137,
 // purely to aid program speed
 //static uint8_t iter_to_sinusoid_index[max_iter] = {0};
 
+#if LED_ENGINE == LED_ENGINE_TABLE
+#define ticks_per_point                 (max_iter / sinusoid_size)                          // 80 ticks per sinusoid point
+#define periods_per_point               (ticks_per_point / max_led_blink_period_size)      // 4 PWM periods per sinusoid point
+
+// where each LED is within its waveform - kept in step with its iterator
+typedef struct
+{
+    uint8_t point;          // sinusoid point
+    uint8_t period;         // PWM period within the sinusoid point
+    uint8_t period_tick;    // tick within the PWM period
+} LedPhase;
+
+static LedPhase led_phase[9];
+
+#if LED_BAM_FUSED
+#define pwm_table_levels                BAM_LEVELS                  // BAM level, out of 255
+#elif LED_PIPELINE == LED_PIPELINE_FRAME
+#define pwm_table_levels                LED_LEVEL_MAX               // frame level, out of 255
+#else
+#define pwm_table_levels                max_led_blink_period_size   // on-time in ticks, out of one PWM period
+#endif
+
+// PWM on-time in pwm_table_levels for each sinusoid point at table_brightness. The extra last entry (0) covers iter == max_iter.
+static uint8_t pwm_on_ticks[sinusoid_size + 1] = {0};
+static uint8_t table_brightness = 0;
+#endif
+
+#if LED_BAM_FUSED
+// BAM level of every LED, handed to the BAM driver once per sinusoid point. LEDs not running a waveform stay at 0.
+static uint8_t led_levels[LED_COUNT] = {0};
+#endif
+
+#if LED_SCHEDULER == LED_SCHEDULER_TICKLESS
+// ticks programmed for the current sleep, so the animation can be caught up when it ends. 0 = just started.
+static uint16_t led_sleep_ticks = 0;
+#endif
+
+#if LED_PWM_BACKEND == LED_PWM_TIMER
+#define pwm_period_counts               (max_led_blink_period_size * TICK_ACLK_COUNTS)      // 340 ACLK counts = 10 ms
+
+// TB0 compare channel per LED. twinkle_two() group 1 (1, 4, 7, 3, 9) shares TB0.2 and group 2 (2, 5, 8, 6) shares TB0.1,
+// so LED9 and LED8 land on their own Timer_B output pins.
+static const uint8_t led_pwm_channel[9] = {PWM_CHANNEL_2, PWM_CHANNEL_1, PWM_CHANNEL_2, PWM_CHANNEL_2, PWM_CHANNEL_1,
+                                           PWM_CHANNEL_1, PWM_CHANNEL_2, PWM_CHANNEL_1, PWM_CHANNEL_2};
+#endif
+
 // private functions
-uint8_t increment_iter(uint16_t *iter);
+uint8_t increment_iter(uint16_t *iter, uint16_t step);
+void add_to_frame(LedFrame *frame, uint8_t led_num);
+void start_animation(const LedAnimation *animation);
+#if LED_ENGINE == LED_ENGINE_TABLE
+void build_pwm_table(uint8_t brightness);
+void set_led_phase(LedPhase *phase, uint16_t iter);
+#endif
+#if LED_PIPELINE == LED_PIPELINE_FRAME
+uint8_t frame_single_led(uint8_t led_num, uint16_t *iter, uint8_t brightness, LedLevels *levels);
+void animation_frame(const LedAnimation *animation, LedLevels *levels, uint8_t brightness);
+#endif
+#if LED_SCHEDULER == LED_SCHEDULER_TICKLESS
+uint16_t hold_led(uint8_t led_num, uint16_t iter, uint8_t brightness, LedFrame *frame);
+uint8_t step_led(uint8_t led_num, uint16_t *iter, uint16_t ticks);
+#endif
 
 
 /**
  * @brief Private function to led_control.c: increment an animation iterator and wrap around when the full cycle has completed.
  * @ingroup LED_CONTROL
  * @param iter Pointer to the animation iterator for this LED.
+ * @param step Ticks to advance by - 1 per tick, or a whole PWM period with LED_PWM_TIMER.
  * @return Returns an "end" bool - if the LED input and its associated iterator have reached the end of the animation instance.
  * @note This is an internal helper; it is not exposed in the public header.
  */
-uint8_t increment_iter(uint16_t *iter)
+RAMFUNC uint8_t increment_iter(uint16_t *iter, uint16_t step)
 {
     uint8_t end_reached = 0;
     if (*iter < max_iter)
     {
-        *iter += 1;        
+        *iter += step;        
     }
     else 
     {
@@ -60,6 +171,65 @@ uint8_t increment_iter(uint16_t *iter)
     return end_reached;
 }
 
+/**
+ * @brief Private function to led_control.c: mark an LED as on in this tick's output frame.
+ * @ingroup LED_CONTROL
+ * @param frame Output frame being built.
+ * @param led_num Index of the LED (1-based).
+ * @note This is an internal helper; it is not exposed in the public header.
+ */
+RAMFUNC void add_to_frame(LedFrame *frame, uint8_t led_num)
+{
+    const LedFrame *bits = &led_frame_bits[led_num-1];
+
+    frame->p1_out |= bits->p1_out;
+    frame->p3_out |= bits->p3_out;
+}
+
+#if LED_ENGINE == LED_ENGINE_TABLE
+/**
+ * @brief Private function to led_control.c: rebuild the PWM on-time table for a new brightness.
+ * @ingroup LED_CONTROL
+ * @param brightness PWM scaling factor - where 255 = 1, 127 = 0.5, etc.
+ * @note This is the only place the table engine multiplies, and it runs at most once per brightness change (1 s tick).
+ *       So with LED_GAMMA_CIE the gamma costs nothing per tick.
+ */
+void build_pwm_table(uint8_t brightness)
+{
+    uint8_t i;
+    for (i = 0; i < sinusoid_size; i++)
+    {
+#if (LED_GAMMA == LED_GAMMA_CIE) && (LED_PIPELINE == LED_PIPELINE_FUSED)
+        // sinusoid x ambient scale is the lightness; the table holds the duty that looks that bright
+        uint8_t lightness = (uint8_t)(((uint16_t)sinusoid[i] * brightness) >> 8);
+        pwm_on_ticks[i] = (uint8_t)(((uint16_t)led_gamma(lightness) * pwm_table_levels) >> 8);
+#else
+        // with LED_PIPELINE_FRAME the output stage applies the gamma to the whole frame
+        pwm_on_ticks[i] = (uint8_t)(((uint32_t)sinusoid[i] * pwm_table_levels * brightness) >> 16);
+#endif
+    }
+    pwm_on_ticks[sinusoid_size] = 0;
+    table_brightness = brightness;
+}
+
+/**
+ * @brief Private function to led_control.c: derive an LED's waveform phase from its iterator.
+ * @ingroup LED_CONTROL
+ * @param phase Phase to set.
+ * @param iter Animation iterator for the same LED.
+ * @note Uses division, so only called from start_animation().
+ */
+void set_led_phase(LedPhase *phase, uint16_t iter)
+{
+    uint16_t tick_in_point;
+
+    phase->point = (uint8_t)(iter / ticks_per_point);
+    tick_in_point = iter - (uint16_t)phase->point * ticks_per_point;
+    phase->period = (uint8_t)(tick_in_point / max_led_blink_period_size);
+    phase->period_tick = (uint8_t)(tick_in_point - phase->period * max_led_blink_period_size);
+}
+#endif
+
 void init_twinkle(void)
 {
     /*
@@ -70,10 +240,157 @@ void init_twinkle(void)
         iter_to_sinusoid_index[i] = (uint8_t)(((uint32_t)i * sinusoid_size) / max_iter);
     }
     */
-        
+#if LED_ENGINE == LED_ENGINE_TABLE
+    build_pwm_table(255);
+#endif
+#if LED_PWM_BACKEND == LED_PWM_TIMER
+    init_pwm(pwm_period_counts);
+#endif
+#if LED_BAM_FUSED
+    init_bam();
+    millis_timer_set_period(ticks_per_point);
+#endif
+#if LED_PIPELINE == LED_PIPELINE_FRAME
+    init_led_output();
+#endif
 }
 
-uint8_t sine_single_led(uint8_t led_num, uint16_t *iter, uint8_t brightness)
+#if LED_PIPELINE == LED_PIPELINE_FRAME
+/**
+ * @brief Private function to led_control.c: advance one LED's waveform by a frame and write its level.
+ * @ingroup LED_CONTROL
+ * @param led_num Index of the LED (1-based).
+ * @param iter Pointer to the animation iterator for this LED.
+ * @param brightness PWM scaling factor - where 255 = 1, 127 = 0.5, etc.
+ * @param levels Frame being filled.
+ * @return Returns an "end" bool - if the LED input and its associated iterator have reached the end of the animation instance.
+ * @note This is an internal helper; it is not exposed in the public header.
+ *       The frame-pipeline counterpart of sine_single_led(): no edges, just one table read per LED per frame.
+ */
+uint8_t frame_single_led(uint8_t led_num, uint16_t *iter, uint8_t brightness, LedLevels *levels)
+{
+    LedPhase *phase = &led_phase[led_num-1];
+
+    if (brightness != table_brightness)
+    {
+        build_pwm_table(brightness);
+    }
+
+    levels->level[led_num-1] = pwm_on_ticks[phase->point];
+
+    // step the phase on by one frame, which is one PWM period
+    phase->period += 1;
+    if (phase->period == periods_per_point)
+    {
+        phase->period = 0;
+        phase->point += 1;
+    }
+
+    uint8_t end = increment_iter(iter, LED_FRAME_TICKS);
+    if (end)
+    {
+        phase->point = 0;
+        phase->period = 0;
+    }
+    return end;
+}
+#elif LED_PWM_BACKEND == LED_PWM_TIMER
+uint8_t sine_single_led(uint8_t led_num, uint16_t *iter, uint8_t brightness, LedFrame *frame)
+{
+    LedPhase *phase = &led_phase[led_num-1];
+    uint8_t channel = led_pwm_channel[led_num-1];
+
+    if (brightness != table_brightness)
+    {
+        build_pwm_table(brightness);
+    }
+
+    // the duty only changes at sinusoid point boundaries, so that is the only time the compare value is reloaded
+    if (phase->period == 0)
+    {
+        pwm_set_duty(channel, led_list[led_num-1], led_port_list[led_num-1], (uint16_t)pwm_on_ticks[phase->point] * TICK_ACLK_COUNTS);
+    }
+    pwm_period_start(channel);
+
+    // step the phase on by one PWM period
+    phase->period += 1;
+    if (phase->period == periods_per_point)
+    {
+        phase->period = 0;
+        phase->point += 1;
+    }
+
+    uint8_t end = increment_iter(iter, max_led_blink_period_size);
+    if (end)
+    {
+        phase->point = 0;
+        phase->period = 0;
+    }
+    return end;
+
+}
+#elif LED_BAM_FUSED
+uint8_t sine_single_led(uint8_t led_num, uint16_t *iter, uint8_t brightness, LedFrame *frame)
+{
+    LedPhase *phase = &led_phase[led_num-1];
+
+    if (brightness != table_brightness)
+    {
+        build_pwm_table(brightness);
+    }
+
+    // one call per sinusoid point: the BAM timer holds the level until the next one
+    led_levels[led_num-1] = pwm_on_ticks[phase->point];
+    phase->point += 1;
+
+    uint8_t end = increment_iter(iter, ticks_per_point);
+    if (end)
+    {
+        phase->point = 0;
+    }
+    return end;
+
+}
+#elif LED_ENGINE == LED_ENGINE_TABLE
+RAMFUNC uint8_t sine_single_led(uint8_t led_num, uint16_t *iter, uint8_t brightness, LedFrame *frame)
+{
+    LedPhase *phase = &led_phase[led_num-1];
+
+    if (brightness != table_brightness)
+    {
+        build_pwm_table(brightness);
+    }
+
+    if (phase->period_tick < pwm_on_ticks[phase->point])
+    {
+        add_to_frame(frame, led_num);
+    }
+
+    // step the phase on by one tick
+    phase->period_tick += 1;
+    if (phase->period_tick == max_led_blink_period_size)
+    {
+        phase->period_tick = 0;
+        phase->period += 1;
+        if (phase->period == periods_per_point)
+        {
+            phase->period = 0;
+            phase->point += 1;
+        }
+    }
+
+    uint8_t end = increment_iter(iter, 1);
+    if (end)
+    {
+        phase->point = 0;
+        phase->period = 0;
+        phase->period_tick = 0;
+    }
+    return end;
+
+}
+#else
+RAMFUNC uint8_t sine_single_led(uint8_t led_num, uint16_t *iter, uint8_t brightness, LedFrame *frame)
 {
     //uint8_t sinusoid_index = iter_to_sinusoid_index[*iter]; 
     uint8_t sinusoid_index = (uint8_t)(((uint32_t)(*iter) * sinusoid_size * (uint32_t)max_iter_recip) >> 16);
@@ -94,209 +411,312 @@ uint8_t sine_single_led(uint8_t led_num, uint16_t *iter, uint8_t brightness)
 
     if (*iter < transition_to_low)
     {
-        set_gpio(led_list[led_num-1], led_port_list[led_num-1]);
-    }
-    else
-    {
-        clear_gpio(led_list[led_num-1], led_port_list[led_num-1]);
+        add_to_frame(frame, led_num);
     }
 
 
-    uint8_t end = increment_iter(iter);
+    uint8_t end = increment_iter(iter, 1);
     return end;
 
 }
+#endif
 
-void twinkle_three(uint8_t brightness)
+#if LED_SCHEDULER == LED_SCHEDULER_TICKLESS
+/**
+ * @brief Private function to led_control.c: set an LED's output for now and work out how long it stays that way.
+ * @ingroup LED_CONTROL
+ * @param led_num Index of the LED (1-based).
+ * @param iter Animation iterator for the same LED.
+ * @param brightness PWM scaling factor - where 255 = 1, 127 = 0.5, etc.
+ * @param frame Output frame for this wakeup; the LED's bit is set in it when the LED should be on.
+ * @return Ticks until the LED's next edge or the end of its waveform, whichever is first.
+ *         A dark LED looks ahead across every following sinusoid point with a zero on-time, up to
+ *         LED_MAX_HOLD_TICKS.
+ * @note This is an internal helper; it is not exposed in the public header.
+ */
+uint16_t hold_led(uint8_t led_num, uint16_t iter, uint8_t brightness, LedFrame *frame)
 {
-    // GROUP 1: LEDs 1 -> 4 -> 7 twinkle with iter offset of 0
-    if (led_active_track.led1_active)
+    LedPhase *phase = &led_phase[led_num-1];
+    uint8_t on_ticks;
+    uint8_t point;
+    uint16_t hold;
+
+    if (brightness != table_brightness)
     {
-        uint8_t end = sine_single_led(1, &led_iters.led1_iter, brightness);
-        if (end)
-        {
-            led_active_track.led1_active = 0;
-            led_active_track.led4_active = 1;
-        }
+        build_pwm_table(brightness);
     }
-    else if (led_active_track.led4_active) 
+
+    // the end tick, where the group hands over to its next LED
+    if (iter >= max_iter)
     {
-        uint8_t end = sine_single_led(4, &led_iters.led4_iter, brightness);
-        if (end)
-        {
-            led_active_track.led4_active = 0;
-            led_active_track.led7_active = 1;
-        }
+        return 1;
     }
-    else if (led_active_track.led7_active) 
+
+    on_ticks = pwm_on_ticks[phase->point];
+    if (phase->period_tick < on_ticks)
     {
-        uint8_t end = sine_single_led(7, &led_iters.led7_iter, brightness);
-        if (end)
-        {
-            led_active_track.led7_active = 0;
-            led_active_track.led1_active = 1;
-        }
-    }
-    else {
-        // invalid. error handling TBC
+        add_to_frame(frame, led_num);
+        return on_ticks - phase->period_tick;
     }
 
-    // GROUP 2: LEDs 2 -> 5 -> 8 twinkle with iter offset defined in led_iters
-    if (led_active_track.led2_active)
+    // off until the next PWM period starts
+    hold = max_led_blink_period_size - phase->period_tick;
+    if (on_ticks == 0)
     {
-        uint8_t end = sine_single_led(2, &led_iters.led2_iter, brightness);
-        if (end)
+        // ... or for the rest of the sinusoid point, and any dark points after it
+        hold += (periods_per_point - 1 - phase->period) * max_led_blink_period_size;
+        for (point = phase->point + 1; (point < sinusoid_size) && (pwm_on_ticks[point] == 0) && (hold < LED_MAX_HOLD_TICKS); point++)
         {
-            led_active_track.led2_active = 0;
-            led_active_track.led5_active = 1;
+            hold += ticks_per_point;
         }
-    }
-    else if (led_active_track.led5_active) 
-    {
-        uint8_t end = sine_single_led(5, &led_iters.led5_iter, brightness);
-        if (end)
+        if (hold > LED_MAX_HOLD_TICKS)
         {
-            led_active_track.led5_active = 0;
-            led_active_track.led8_active = 1;
+            hold = LED_MAX_HOLD_TICKS;  // the last dark point can take it past the limit; the LED is still dark then
         }
     }
-    else if (led_active_track.led8_active) 
+    return hold;
+}
+
+/**
+ * @brief Private function to led_control.c: advance an LED's waveform by several ticks at once.
+ * @ingroup LED_CONTROL
+ * @param led_num Index of the LED (1-based).
+ * @param iter Pointer to the animation iterator for this LED.
+ * @param ticks Ticks to advance by, no more than hold_led() returned for the LED.
+ * @return Returns an "end" bool - if the LED input and its associated iterator have reached the end of the animation instance.
+ * @note This is an internal helper; it is not exposed in the public header.
+ */
+uint8_t step_led(uint8_t led_num, uint16_t *iter, uint16_t ticks)
+{
+    LedPhase *phase = &led_phase[led_num-1];
+
+    uint8_t end = increment_iter(iter, ticks);
+    if (end)
     {
-        uint8_t end = sine_single_led(8, &led_iters.led8_iter, brightness);
-        if (end)
-        {
-            led_active_track.led8_active = 0;
-            led_active_track.led2_active = 1;
-        }
-    }
-    else {
-        // invalid. error handling TBC
+        phase->point = 0;
+        phase->period = 0;
+        phase->period_tick = 0;
+        return end;
     }
-    
-    // GROUP 3: LEDs 3 -> 6 -> 9 twinkle with iter offset defined in led_iters
-    if (led_active_track.led3_active)
+
+    // step the phase on a PWM period at a time - no division
+    while (ticks >= (uint16_t)(max_led_blink_period_size - phase->period_tick))
     {
-        uint8_t end = sine_single_led(3, &led_iters.led3_iter, brightness);
-        if (end)
+        ticks -= max_led_blink_period_size - phase->period_tick;
+        phase->period_tick = 0;
+        phase->period += 1;
+        if (phase->period == periods_per_point)
         {
-            led_active_track.led3_active = 0;
-            led_active_track.led6_active = 1;
+            phase->period = 0;
+            phase->point += 1;
         }
     }
-    else if (led_active_track.led6_active) 
+    phase->period_tick += (uint8_t)ticks;
+    return end;
+}
+#endif
+
+/**
+ * @brief Private function to led_control.c: put every group of an animation at its start state.
+ * @ingroup LED_CONTROL
+ * @param animation Animation about to run.
+ * @note This is an internal helper; it is not exposed in the public header.
+ */
+void start_animation(const LedAnimation *animation)
+{
+    uint8_t group;
+#if LED_ENGINE == LED_ENGINE_TABLE
+    uint8_t i;
+    for (i = 0; i < 9; i++)
     {
-        uint8_t end = sine_single_led(6, &led_iters.led6_iter, brightness);
-        if (end)
-        {
-            led_active_track.led6_active = 0;
-            led_active_track.led9_active = 1;
-        }
+        led_phase[i].point = 0;
+        led_phase[i].period = 0;
+        led_phase[i].period_tick = 0;
     }
-    else if (led_active_track.led9_active) 
+#endif
+#if LED_BAM_FUSED
+    for (i = 0; i < LED_COUNT; i++)
     {
-        uint8_t end = sine_single_led(9, &led_iters.led9_iter, brightness);
-        if (end)
-        {
-            led_active_track.led9_active = 0;
-            led_active_track.led3_active = 1;
-        }
-    }
-    else {
-        // invalid. error handling TBC
+        led_levels[i] = 0;
     }
-}
+#endif
 
-void twinkle_two(uint8_t brightness)
-{
-    // GROUP 1: LEDs 1 -> 4 -> 7 -> 3 -> 9 twinkle with iter offset of 0
-    if (led_active_track.led1_active)
+    for (group = 0; group < animation->group_count; group++)
     {
-        uint8_t end = sine_single_led(1, &led_iters.led1_iter, brightness);
-        if (end)
+        const LedSequence *sequence = &animation->groups[group];
+        uint8_t step = 0;
+        uint16_t iter = sequence->start_iter;
+
+        // a resumed phase is only taken if it fits this animation, since it may come from another build
+        if (resume_pending && resume_track.step[group] < sequence->length && resume_iters.iter[group] <= max_iter)
         {
-            led_active_track.led1_active = 0;
-            led_active_track.led4_active = 1;
+            step = resume_track.step[group];
+            iter = resume_iters.iter[group];
         }
+        led_active_track.step[group] = step;
+        led_iters.iter[group] = iter;
+#if LED_ENGINE == LED_ENGINE_TABLE
+        set_led_phase(&led_phase[sequence->leds[step]-1], iter);
+#endif
     }
-    else if (led_active_track.led4_active) 
+    resume_pending = 0;
+    current_animation = animation;
+#if LED_SCHEDULER == LED_SCHEDULER_TICKLESS
+    led_sleep_ticks = 0;
+#endif
+}
+
+#if LED_PIPELINE == LED_PIPELINE_FRAME
+/**
+ * @brief Private function to led_control.c: write the next frame of an animation.
+ * @ingroup LED_CONTROL
+ * @param animation Animation to run. Switching to a different animation restarts it from its start state.
+ * @param levels Frame to fill.
+ * @param brightness PWM scaling factor - where 255 = 1, 127 = 0.5, etc.
+ * @note This is an internal helper; it is not exposed in the public header.
+ */
+void animation_frame(const LedAnimation *animation, LedLevels *levels, uint8_t brightness)
+{
+    const LedSequence *sequence = animation->groups;
+    const LedSequence *last = sequence + animation->group_count;
+    uint8_t *step = led_active_track.step;
+    uint16_t *iter = led_iters.iter;
+    uint8_t led;
+
+    if (animation != current_animation)
     {
-        uint8_t end = sine_single_led(4, &led_iters.led4_iter, brightness);
-        if (end)
-        {
-            led_active_track.led4_active = 0;
-            led_active_track.led7_active = 1;
-        }
+        start_animation(animation);
     }
-    else if (led_active_track.led7_active) 
+
+    // LEDs no group is running stay dark
+    for (led = 0; led < LED_COUNT; led++)
     {
-        uint8_t end = sine_single_led(7, &led_iters.led7_iter, brightness);
-        if (end)
-        {
-            led_active_track.led7_active = 0;
-            led_active_track.led3_active = 1;
-        }
+        levels->level[led] = 0;
     }
-    else if (led_active_track.led3_active) 
+
+    for (; sequence < last; sequence++, step++, iter++)
     {
-        uint8_t end = sine_single_led(3, &led_iters.led3_iter, brightness);
+        uint8_t end = frame_single_led(sequence->leds[*step], iter, brightness, levels);
         if (end)
         {
-            led_active_track.led3_active = 0;
-            led_active_track.led9_active = 1;
+            // hand over to the next LED in the sequence
+            *step += 1;
+            if (*step == sequence->length)
+            {
+                *step = 0;
+            }
         }
     }
-    else if (led_active_track.led9_active) 
+}
+
+void run_animation(const LedAnimation *animation, uint8_t brightness)
+{
+    // render this tick, and make the next frame when the output stage asks for it
+    if (led_output_tick())
     {
-        uint8_t end = sine_single_led(9, &led_iters.led9_iter, brightness);
-        if (end)
-        {
-            led_active_track.led9_active = 0;
-            led_active_track.led1_active = 1;
-        }
-    }
-    else {
-        // invalid. error handling TBC
+        animation_frame(animation, led_output_back(), brightness);
+        led_output_publish();
     }
+}
+#else
+RAMFUNC void run_animation(const LedAnimation *animation, uint8_t brightness)
+{
+    LedFrame frame = {0, 0};
+    const LedSequence *sequence = animation->groups;
+    const LedSequence *last = sequence + animation->group_count;
+    uint8_t *step = led_active_track.step;
+    uint16_t *iter = led_iters.iter;
 
-    // GROUP 2: LEDs 2 -> 5 -> 8 -> 6 twinkle with iter offset defined in led_iters
-    if (led_active_track.led2_active)
+    if (animation != current_animation)
     {
-        uint8_t end = sine_single_led(2, &led_iters.led2_iter, brightness);
-        if (end)
-        {
-            led_active_track.led2_active = 0;
-            led_active_track.led5_active = 1;
-        }
+        start_animation(animation);
     }
-    else if (led_active_track.led5_active) 
+
+#if LED_SCHEDULER == LED_SCHEDULER_TICKLESS
+    uint16_t hold = LED_MAX_HOLD_TICKS;
+
+    // catch every group up by the ticks slept, then find the soonest LED edge
+    for (; sequence < last; sequence++, step++, iter++)
     {
-        uint8_t end = sine_single_led(5, &led_iters.led5_iter, brightness);
-        if (end)
+        if (led_sleep_ticks && step_led(sequence->leds[*step], iter, led_sleep_ticks))
         {
-            led_active_track.led5_active = 0;
-            led_active_track.led8_active = 1;
+            // hand over to the next LED in the sequence
+            *step += 1;
+            if (*step == sequence->length)
+            {
+                *step = 0;
+            }
         }
-    }
-    else if (led_active_track.led8_active) 
-    {
-        uint8_t end = sine_single_led(8, &led_iters.led8_iter, brightness);
-        if (end)
+
+        uint16_t led_hold = hold_led(sequence->leds[*step], *iter, brightness, &frame);
+        if (led_hold < hold)
         {
-            led_active_track.led8_active = 0;
-            led_active_track.led6_active = 1;
+            hold = led_hold;
         }
     }
-    else if (led_active_track.led6_active) 
+
+    millis_timer_set_deadline(hold);
+    led_sleep_ticks = hold;
+#else
+    // walk the groups with pointers, so there is no per-group index arithmetic
+    for (; sequence < last; sequence++, step++, iter++)
     {
-        uint8_t end = sine_single_led(6, &led_iters.led6_iter, brightness);
+        uint8_t end = sine_single_led(sequence->leds[*step], iter, brightness, &frame);
         if (end)
         {
-            led_active_track.led6_active = 0;
-            led_active_track.led2_active = 1;
+            // hand over to the next LED in the sequence
+            *step += 1;
+            if (*step == sequence->length)
+            {
+                *step = 0;
+            }
         }
     }
-    else {
-        // invalid. error handling TBC
-    }
+#endif
+
+#if LED_PWM_BACKEND == LED_PWM_SOFTWARE
+    // commit every LED edge of this tick at once
+    write_led_frame(&frame);
+#elif LED_BAM_FUSED
+    // the BAM driver shows the new levels from its next frame
+    bam_set_levels(led_levels);
+#endif
+}
+#endif
+
+void resume_animation(const LedIters *iters, const LedActiveTracker *track)
+{
+    resume_iters = *iters;
+    resume_track = *track;
+    resume_pending = 1;
 }
 
+void stop_animation(void)
+{
+    current_animation = 0;
+#if LED_PIPELINE == LED_PIPELINE_FRAME
+    led_output_stop();
+#elif LED_BAM_FUSED
+    bam_stop();
+#endif
+}
+
+#if LED_PWM_BACKEND != LED_PWM_TIMER
+RAMFUNC void twinkle_three(uint8_t brightness)
+{
+    // GROUP 1: LEDs 1 -> 4 -> 7, GROUP 2: LEDs 2 -> 5 -> 8 offset by half a waveform, GROUP 3: LEDs 3 -> 6 -> 9
+    run_animation(&twinkle_three_animation, brightness);
+}
+#endif
+
+RAMFUNC void twinkle_two(uint8_t brightness)
+{
+    // GROUP 1: LEDs 1 -> 4 -> 7 -> 3 -> 9, GROUP 2: LEDs 2 -> 5 -> 8 -> 6 offset by half a waveform
+    run_animation(&twinkle_two_animation, brightness);
+}
+
+RAMFUNC void twinkle_one(uint8_t brightness)
+{
+    // LEDs 1 -> 4 -> 7 -> 2 -> 5 -> 8 -> 3 -> 6 -> 9, or 1 -> 4 -> 7 -> 3 -> 9 with LED_PWM_TIMER
+    run_animation(&twinkle_one_animation, brightness);
+}
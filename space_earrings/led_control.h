@@ -7,38 +7,96 @@
 #define LED_CONTROL_H
 
 #include <stdint.h>
+#include "drivers/gpio.h"
 
 /**
  * @defgroup LED_CONTROL LED animation control
  * @brief High-level twinkle animation and per-LED PWM waveforms.
  * @{
  */
+
+// PWM engine selection for sine_single_led()
+#define LED_ENGINE_ARITHMETIC           0   // integer maths from the iterator on every tick (always LED_GAMMA_LINEAR)
+#define LED_ENGINE_TABLE                1   // per-brightness on-time table, one table read and one compare per tick
+
+#ifndef LED_ENGINE
+#define LED_ENGINE                      LED_ENGINE_TABLE
+#endif
+
+// PWM backend selection
+#define LED_PWM_SOFTWARE                0   // LED pins toggled by sine_single_led() on every 0.5 ms tick
+#define LED_PWM_TIMER                   1   // Timer_B0 compare channels, CPU wakes once per PWM period (needs LED_ENGINE_TABLE)
+#define LED_PWM_BAM                     2   // Timer_B2 bit-angle modulation of all 9 LEDs, CPU wakes once per sinusoid point (needs LED_ENGINE_TABLE)
+
+#ifndef LED_PWM_BACKEND
+#define LED_PWM_BACKEND                 LED_PWM_SOFTWARE
+#endif
+
+#if (LED_PWM_BACKEND == LED_PWM_TIMER) && (LED_ENGINE != LED_ENGINE_TABLE)
+#error "LED_PWM_TIMER reloads compare values from the LED_ENGINE_TABLE on-time table"
+#endif
+
+#if (LED_PWM_BACKEND == LED_PWM_BAM) && (LED_ENGINE != LED_ENGINE_TABLE)
+#error "LED_PWM_BAM takes each LED's level from the LED_ENGINE_TABLE on-time table"
+#endif
+
+// animation tick scheduling with LED_PWM_SOFTWARE
+#define LED_SCHEDULER_FIXED             0   // TB0 wakes the CPU on every 0.5 ms tick
+#define LED_SCHEDULER_TICKLESS          1   // TB0 wakes the CPU only at the next LED edge (needs LED_ENGINE_TABLE)
+
+#ifndef LED_SCHEDULER
+#define LED_SCHEDULER                   LED_SCHEDULER_FIXED
+#endif
+
+#if (LED_SCHEDULER == LED_SCHEDULER_TICKLESS) && ((LED_ENGINE != LED_ENGINE_TABLE) || (LED_PWM_BACKEND != LED_PWM_SOFTWARE))
+#error "LED_SCHEDULER_TICKLESS looks ahead in the LED_ENGINE_TABLE on-time table and drives the LEDs in software"
+#endif
+
+#define LED_MAX_HOLD_TICKS              200 // longest tickless sleep, 100 ms
+
+// animation pipeline
+#define LED_PIPELINE_FUSED              0   // sine_single_led() works out every LED edge from the animation on each tick
+#define LED_PIPELINE_FRAME              1   // the animation writes a level frame at 100 Hz and LED_OUTPUT renders it (led_output.h)
+
+#ifndef LED_PIPELINE
+#define LED_PIPELINE                    LED_PIPELINE_FUSED
+#endif
+
+#if (LED_PIPELINE == LED_PIPELINE_FRAME) && ((LED_ENGINE != LED_ENGINE_TABLE) || (LED_PWM_BACKEND == LED_PWM_TIMER) || (LED_SCHEDULER != LED_SCHEDULER_FIXED))
+#error "LED_PIPELINE_FRAME takes levels from the LED_ENGINE_TABLE on-time table and renders them with software PWM or BAM on a fixed tick"
+#endif
+
+#define LED_MAX_GROUPS                  3   // most LEDs an animation lights at once
+
+/** One group of an animation: the LEDs that take turns running the waveform. */
+typedef struct
+{
+    const uint8_t *leds;        // LED numbers (1-9) in hand-off order
+    uint8_t length;             // number of LEDs in leds
+    uint16_t start_iter;        // iterator of the group's first LED when the animation starts - staggers the groups
+} LedSequence;
+
+/** An animation: one sequence per group, all running side by side. Define instances const so they stay in FRAM. */
+typedef struct
+{
+    uint8_t group_count;
+    LedSequence groups[LED_MAX_GROUPS];
+} LedAnimation;
+
 typedef struct 
 {
-    uint16_t led1_iter;
-    uint16_t led2_iter;
-    uint16_t led3_iter;
-    uint16_t led4_iter;
-    uint16_t led5_iter;
-    uint16_t led6_iter;
-    uint16_t led7_iter;
-    uint16_t led8_iter;
-    uint16_t led9_iter;
+    uint16_t iter[LED_MAX_GROUPS];      // animation iterator of each group's active LED
 } LedIters;
 
 typedef struct 
 {
-    uint8_t led1_active;
-    uint8_t led2_active;
-    uint8_t led3_active;
-    uint8_t led4_active;
-    uint8_t led5_active;
-    uint8_t led6_active;
-    uint8_t led7_active;
-    uint8_t led8_active;
-    uint8_t led9_active;
+    uint8_t step[LED_MAX_GROUPS];       // index of each group's active LED within its sequence
 } LedActiveTracker;
 
+// animation phase of the running animation, snapshotted by RESUME_STATE
+extern LedIters led_iters;
+extern LedActiveTracker led_active_track;
+
 /**
  * @brief Drive all LEDs with a simple on/off blink pattern (used mainly for testing).
  * @ingroup LED_CONTROL
@@ -48,25 +106,73 @@ void simple_blink(void);
 /**
  * @brief Initialise twinkle animation state, lookup tables and per-LED iterators.
  * @ingroup LED_CONTROL
+ * @note With LED_ENGINE_TABLE this also derives each LED's waveform phase from its starting iterator.
+ *       With LED_PWM_TIMER it also sets the TB0 period to one PWM period, so must run after clock_init().
+ *       With LED_PWM_BAM it starts the BAM timer and sets the TB0 period to one sinusoid point, so must run after clock_init().
+ *       With LED_PIPELINE_FRAME it starts the output stage instead, see init_led_output().
  */
 void init_twinkle(void);
 
+#if LED_PIPELINE == LED_PIPELINE_FUSED
 /**
  * @brief Update one LED with a sinusoidal PWM pattern for the twinkle effect.
  * @ingroup LED_CONTROL
  * @param led_num Index of the LED being updated (1-based).
  * @param iter Pointer to the animation iterator for this specific LED.
  * @param brightness Current logical brightness level or PWM scaling factor - where 255 = 1, 127 = 0.5, etc.
+ * @param frame Output frame for this tick; the LED's bit is set in it when the LED should be on. Unused with LED_PWM_TIMER and LED_PWM_BAM.
  * @return Returns an "end" bool - if the LED input and its associated iterator have reached the end of the animation instance.
+ * @note With LED_ENGINE_TABLE the on-time table is rebuilt only when brightness differs from the previous call,
+ *       and the iterator must only be advanced by this function, since the LED's waveform phase is tracked alongside it.
+ *       With LED_PWM_TIMER this is called once per PWM period rather than once per tick: it advances the iterator by a whole
+ *       period and reloads the LED's compare channel at each sinusoid point.
+ *       With LED_PWM_BAM it is called once per sinusoid point: it advances the iterator by a whole point and sets the LED's level.
+ *       Not available with LED_PIPELINE_FRAME, where the animation writes levels into a frame instead.
+ */
+uint8_t sine_single_led(uint8_t led_num, uint16_t *iter, uint8_t brightness, LedFrame *frame);
+#endif
+
+/**
+ * @brief Advance an animation by one tick: run the active LED of every group and hand over to the next LED in its sequence when its waveform ends.
+ * @ingroup LED_CONTROL
+ * @param animation Animation to run. Switching to a different animation restarts it from its start state.
+ * @param brightness Current logical brightness level or PWM scaling factor.
+ * @note The cost per tick depends on the number of groups only. With LED_PWM_TIMER an animation can have at most
+ *       PWM_CHANNEL_COUNT groups, and each group's LEDs must share a compare channel.
+ *       With LED_PIPELINE_FRAME each call renders one tick, and every LED_FRAME_TICKS ticks the animation writes the
+ *       next level frame.
+ *       With LED_SCHEDULER_TICKLESS each call first catches the animation up by the ticks slept since the last call,
+ *       then programs the tick timer for the next LED edge, at most LED_MAX_HOLD_TICKS away.
+ */
+void run_animation(const LedAnimation *animation, uint8_t brightness);
+
+/**
+ * @brief Make the next animation to start carry on from a saved phase instead of its start state.
+ * @ingroup LED_CONTROL
+ * @param iters Iterator of each group's active LED, as in led_iters.
+ * @param track Step of each group within its sequence, as in led_active_track.
+ * @note For resuming after a reset. Only applies to the next start; a group whose saved step or iterator does not fit
+ *       the animation starts from its start state.
  */
-uint8_t sine_single_led(uint8_t led_num, uint16_t *iter, uint8_t brightness);
+void resume_animation(const LedIters *iters, const LedActiveTracker *track);
 
+/**
+ * @brief Stop the running animation, e.g. on low battery. The next run_animation() starts it again from its start state.
+ * @ingroup LED_CONTROL
+ * @note With LED_PWM_BAM or LED_PIPELINE_FRAME this also stops the output, which would otherwise keep showing the last levels.
+ *       Turn the LEDs off with turn_off_all_leds() as well for the other backends.
+ */
+void stop_animation(void);
+
+#if LED_PWM_BACKEND != LED_PWM_TIMER
 /**
  * @brief Advance the multi-LED twinkle animation based on the current brightness level. Three LEDs on at a time.
  * @ingroup LED_CONTROL
  * @param brightness Current logical brightness level or PWM scaling factor.
+ * @note Not available with LED_PWM_TIMER: three LEDs at once needs three compare channels and TB0 has two.
  */
 void twinkle_three(uint8_t brightness);
+#endif
 
 /**
  * @brief Advance the multi-LED twinkle animation based on the current brightness level. Two LEDs on at a time. 
@@ -75,5 +181,13 @@ void twinkle_three(uint8_t brightness);
  */
 void twinkle_two(uint8_t brightness);
 
+/**
+ * @brief Advance the single-LED twinkle animation based on the current brightness level. One LED on at a time.
+ * @ingroup LED_CONTROL
+ * @param brightness Current logical brightness level or PWM scaling factor.
+ * @note The battery governor's low-budget animation. With LED_PWM_TIMER it walks only the LEDs on TB0.2.
+ */
+void twinkle_one(uint8_t brightness);
+
 /** @} */
 #endif //LED_CONTROL_H
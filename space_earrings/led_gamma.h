@@ -0,0 +1,46 @@
+/**
+ * @file led_gamma.h
+ * @brief Perceptual (CIE lightness) correction of LED levels.
+ */
+
+#ifndef LED_GAMMA_H
+#define LED_GAMMA_H
+
+#include <stdint.h>
+
+/**
+ * @defgroup LED_GAMMA LED gamma correction
+ * @brief Perceptual (CIE lightness) correction of LED levels.
+ * @{
+ */
+
+// level to duty mapping
+#define LED_GAMMA_LINEAR                0   // a level is the LED duty
+#define LED_GAMMA_CIE                   1   // a level is a perceived lightness, shown at the duty the CIE L* curve gives
+
+#ifndef LED_GAMMA
+#define LED_GAMMA                       LED_GAMMA_CIE
+#endif
+
+#if LED_GAMMA == LED_GAMMA_CIE
+/** Duty (0-255) for each lightness level (0-255). Generated by host_sim/gen_gamma_table.py, kept in FRAM. */
+extern const uint8_t led_gamma_table[256];
+#endif
+
+/**
+ * @brief Map a lightness level to the LED duty that looks that bright.
+ * @ingroup LED_GAMMA
+ * @param level Lightness, 0-255.
+ * @return Returns the duty, 0-255. Full scale maps to full scale; anything lower gets a smaller duty than with LED_GAMMA_LINEAR.
+ */
+static inline uint8_t led_gamma(uint8_t level)
+{
+#if LED_GAMMA == LED_GAMMA_CIE
+    return led_gamma_table[level];
+#else
+    return level;
+#endif
+}
+
+/** @} */
+#endif //LED_GAMMA_H
@@ -0,0 +1,175 @@
+/**
+ * @file led_output.c
+ * @brief Double-buffered LED level frame and the output stage that renders it.
+ * @ingroup LED_OUTPUT
+ */
+
+#include "led_output.h"
+#include "led_gamma.h"
+#include "drivers/gpio.h"
+
+#if LED_PIPELINE == LED_PIPELINE_FRAME
+#if LED_PWM_BACKEND == LED_PWM_BAM
+#include "drivers/bam.h"
+#include "drivers/clock.h"
+#endif
+
+// private variables
+static LedLevels led_frames[2];
+static uint8_t led_back = 0;                    // index of the buffer the animation fills
+
+#if LED_PWM_BACKEND == LED_PWM_SOFTWARE
+// frame bits of each LED, generated from the gpio.h pin map - const, so they stay in FRAM
+static const LedFrame output_led_bits[LED_COUNT] = {LED_PIN_MAP(LED_FRAME_ENTRY)};
+
+static uint8_t frame_pending = 0;               // the back buffer has been published
+static uint8_t pwm_tick = 0;                    // tick within the PWM period
+static LedFrame pwm_on_frame = {0, 0};          // LEDs on at the start of the period
+static LedFrame pwm_off_at[LED_FRAME_TICKS];    // LEDs whose on-time ends at each tick of the period
+static LedFrame pwm_out = {0, 0};               // LEDs on at the current tick
+#endif
+
+// private functions
+#if LED_PWM_BACKEND == LED_PWM_SOFTWARE
+void load_frame(const LedLevels *levels);
+#endif
+
+#if LED_PWM_BACKEND == LED_PWM_SOFTWARE
+/**
+ * @brief Private function to led_output.c: work out the PWM masks of a frame that is about to be shown.
+ * @ingroup LED_OUTPUT
+ * @param levels Frame to show.
+ * @note This is an internal helper; it is not exposed in the public header.
+ *       Runs once per frame, so the per-tick render never looks at an LED's level.
+ */
+void load_frame(const LedLevels *levels)
+{
+    uint8_t led;
+    uint8_t i;
+
+    for (i = 0; i < LED_FRAME_TICKS; i++)
+    {
+        pwm_off_at[i].p1_out = 0;
+        pwm_off_at[i].p3_out = 0;
+    }
+    pwm_on_frame.p1_out = 0;
+    pwm_on_frame.p3_out = 0;
+
+    for (led = 0; led < LED_COUNT; led++)
+    {
+        // on-time in ticks, rounded so that only level 0 is dark and only LED_LEVEL_MAX is on for the whole period
+        uint8_t on_ticks = (uint8_t)(((uint16_t)(levels->level[led] + 1) * LED_FRAME_TICKS) >> 8);
+        const LedFrame *bits = &output_led_bits[led];
+
+        if (on_ticks == 0)
+        {
+            continue;
+        }
+        pwm_on_frame.p1_out |= bits->p1_out;
+        pwm_on_frame.p3_out |= bits->p3_out;
+        if (on_ticks < LED_FRAME_TICKS)
+        {
+            pwm_off_at[on_ticks].p1_out |= bits->p1_out;
+            pwm_off_at[on_ticks].p3_out |= bits->p3_out;
+        }
+    }
+}
+#endif
+
+void init_led_output(void)
+{
+#if LED_PWM_BACKEND == LED_PWM_SOFTWARE
+    LedLevels dark = {{0}};
+
+    led_back = 0;
+    load_frame(&dark);
+    frame_pending = 0;
+    pwm_tick = 0;
+#else
+    led_back = 0;
+    init_bam();
+    millis_timer_set_period(LED_FRAME_TICKS);
+#endif
+}
+
+#if LED_PWM_BACKEND == LED_PWM_SOFTWARE
+uint8_t led_output_tick(void)
+{
+    uint8_t frame_due = 0;
+
+    if (pwm_tick == 0)
+    {
+        // period start: swap in the published frame and ask for the one after it
+        if (frame_pending)
+        {
+            load_frame(&led_frames[led_back]);
+            led_back ^= 1;
+            frame_pending = 0;
+        }
+        pwm_out = pwm_on_frame;
+        frame_due = 1;
+    }
+    else
+    {
+        pwm_out.p1_out &= ~pwm_off_at[pwm_tick].p1_out;
+        pwm_out.p3_out &= ~pwm_off_at[pwm_tick].p3_out;
+    }
+    write_led_frame(&pwm_out);
+
+    pwm_tick += 1;
+    if (pwm_tick == LED_FRAME_TICKS)
+    {
+        pwm_tick = 0;
+    }
+    return frame_due;
+}
+#else
+uint8_t led_output_tick(void)
+{
+    // the BAM timer renders in the background; each tick is a whole frame
+    return 1;
+}
+#endif
+
+LedLevels *led_output_back(void)
+{
+    return &led_frames[led_back];
+}
+
+void led_output_publish(void)
+{
+#if LED_GAMMA == LED_GAMMA_CIE
+    LedLevels *levels = &led_frames[led_back];
+    uint8_t led;
+
+    // animations work in lightness; correct the whole frame once here, never per tick
+    for (led = 0; led < LED_COUNT; led++)
+    {
+        levels->level[led] = led_gamma(levels->level[led]);
+    }
+#endif
+
+#if LED_PWM_BACKEND == LED_PWM_SOFTWARE
+    frame_pending = 1;
+#else
+    // the BAM driver copies the levels into its own back buffer of bit planes
+    bam_set_levels(led_frames[led_back].level);
+    led_back ^= 1;
+#endif
+}
+
+void led_output_stop(void)
+{
+#if LED_PWM_BACKEND == LED_PWM_SOFTWARE
+    LedLevels dark = {{0}};
+
+    load_frame(&dark);
+    frame_pending = 0;
+    pwm_tick = 0;
+    pwm_out = pwm_on_frame;
+    write_led_frame(&pwm_out);
+#else
+    bam_stop();
+#endif
+}
+#endif
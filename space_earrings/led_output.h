@@ -0,0 +1,66 @@
+/**
+ * @file led_output.h
+ * @brief Double-buffered LED level frame and the output stage that renders it.
+ */
+
+#ifndef LED_OUTPUT_H
+#define LED_OUTPUT_H
+
+#include <stdint.h>
+#include "led_control.h"
+
+/**
+ * @defgroup LED_OUTPUT LED output stage
+ * @brief Double-buffered LED level frame and the output stage that renders it.
+ * @{
+ */
+
+#define LED_FRAME_TICKS                 20  // 0.5 ms ticks per frame: one 10 ms software PWM period, 100 Hz animation frame rate
+#define LED_LEVEL_MAX                   255 // level of a fully on LED
+
+/** One frame: the level of every LED, in LED number order. 0 = off, LED_LEVEL_MAX = fully on. */
+typedef struct
+{
+    uint8_t level[LED_COUNT];
+} LedLevels;
+
+/**
+ * @brief Start the output stage with every LED off.
+ * @ingroup LED_OUTPUT
+ * @note With LED_PWM_BAM this starts the BAM timer and sets the TB0 period to one frame, so must run after clock_init().
+ */
+void init_led_output(void);
+
+/**
+ * @brief Render the current frame for one tick.
+ * @ingroup LED_OUTPUT
+ * @return Returns 1 when a new frame is due: fill led_output_back() and call led_output_publish() before the next tick.
+ * @note Software PWM: call on every 0.5 ms tick. Each LED's on-time is worked out once per frame, so a tick is
+ *       one masked write whatever the number of LEDs lit. A new frame is due every LED_FRAME_TICKS ticks.
+ *       BAM: the tick is one frame long and the BAM timer does the rendering, so a new frame is due on every call.
+ */
+uint8_t led_output_tick(void);
+
+/**
+ * @brief Frame for the animation to fill.
+ * @ingroup LED_OUTPUT
+ * @return Returns the back buffer. Its contents are stale; the animation writes every LED's level.
+ */
+LedLevels *led_output_back(void);
+
+/**
+ * @brief Hand the back buffer to the output stage. It is shown from the start of the next PWM or BAM frame.
+ * @ingroup LED_OUTPUT
+ * @note The frame being shown is never written, so a frame is never torn.
+ *       Effects write lightness levels; with LED_GAMMA_CIE the frame is converted to duty here, once per frame.
+ */
+void led_output_publish(void);
+
+/**
+ * @brief Stop the output stage and turn every LED off. The next led_output_tick() starts it again.
+ * @ingroup LED_OUTPUT
+ */
+void led_output_stop(void);
+
+/** @} */
+#endif //LED_OUTPUT_H
@@ -173,6 +173,7 @@ SECTIONS
 
     /* MSP430 INFO memory segments */
     .info : type = NOINIT{} > INFO
+    .resume_state : type = NOINIT{} > INFO  /* resume_state.c: runtime state kept across resets */
 
 
     /* MSP430 interrupt vectors */
@@ -0,0 +1,170 @@
+/**
+ * @file moving_average.h
+ * @brief O(1) running-sum moving average over a power-of-two window, and a first-order IIR (exponential) average.
+ */
+
+#ifndef MOVING_AVERAGE_H
+#define MOVING_AVERAGE_H
+
+#include <stdint.h>
+
+/**
+ * @defgroup MOVING_AVERAGE Moving averages
+ * @brief O(1) running-sum moving average over a power-of-two window, and a first-order IIR (exponential) average.
+ * @{
+ */
+
+#define MOVING_AVERAGE_MAX_SHIFT    8   // largest window is 256 samples; the index is 8 bits
+
+/** Boxcar average of the last 2^shift samples. Declare with MOVING_AVERAGE(), which also allocates the window. */
+typedef struct
+{
+    uint16_t *samples;      // 2^shift entries
+    uint32_t sum;           // sum of the samples in the window
+    uint8_t index;          // slot the next sample replaces
+    uint8_t primed;         // 0 until the first sample, which fills the whole window
+} MovingAverage;
+
+/** First-order IIR average: y += (x - y) / 2^shift, kept as y x 2^shift so no fraction is lost. Declare with EXP_AVERAGE(). */
+typedef struct
+{
+    uint32_t acc;           // the average x 2^shift
+    uint8_t primed;         // 0 until the first sample, which the average starts from
+} ExpAverage;
+
+/**
+ * @brief Add a sample to a moving average.
+ * @ingroup MOVING_AVERAGE
+ * @param ma Moving average.
+ * @param sample New sample.
+ * @param shift log2 of the window, the one ma was declared with.
+ * @return The average of the last 2^shift samples.
+ * @note O(1) whatever the window: the oldest sample is taken off the running sum and the new one added.
+ *       Call it through the name_update() of MOVING_AVERAGE(), which passes the shift as a constant.
+ */
+static inline uint16_t moving_average_update(MovingAverage *ma, uint16_t sample, uint8_t shift)
+{
+    uint16_t i;
+
+    if (!ma->primed)
+    {
+        // fill the window with the first sample, so the average starts there instead of ramping up from 0
+        for (i = 0; i < (1u << shift); i++)
+        {
+            ma->samples[i] = sample;
+        }
+        ma->sum = (uint32_t)sample << shift;
+        ma->primed = 1;
+        return sample;
+    }
+
+    ma->sum += sample;
+    ma->sum -= ma->samples[ma->index];
+    ma->samples[ma->index] = sample;
+    ma->index = (ma->index + 1) & ((1u << shift) - 1);
+
+    return (uint16_t)(ma->sum >> shift);
+}
+
+/**
+ * @brief Return the current value of a moving average.
+ * @ingroup MOVING_AVERAGE
+ * @param ma Moving average.
+ * @param shift log2 of the window, the one ma was declared with.
+ * @return The average of the last 2^shift samples; 0 before the first one.
+ */
+static inline uint16_t moving_average_value(const MovingAverage *ma, uint8_t shift)
+{
+    return (uint16_t)(ma->sum >> shift);
+}
+
+/**
+ * @brief Forget every sample, so the next one fills the window again.
+ * @ingroup MOVING_AVERAGE
+ * @param ma Moving average.
+ */
+static inline void moving_average_reset(MovingAverage *ma)
+{
+    ma->sum = 0;
+    ma->index = 0;
+    ma->primed = 0;
+}
+
+/**
+ * @brief Add a sample to an exponential average.
+ * @ingroup MOVING_AVERAGE
+ * @param ea Exponential average.
+ * @param sample New sample.
+ * @param shift log2 of the time constant, the one ea was declared with.
+ * @return The new average. It moves 1/2^shift of the way to each sample, and needs no sample history.
+ * @note Call it through the name_update() of EXP_AVERAGE(), which passes the shift as a constant.
+ */
+static inline uint16_t exp_average_update(ExpAverage *ea, uint16_t sample, uint8_t shift)
+{
+    if (!ea->primed)
+    {
+        ea->acc = (uint32_t)sample << shift;
+        ea->primed = 1;
+        return sample;
+    }
+
+    // acc holds y x 2^shift, so y += (x - y) / 2^shift is acc += x - y
+    ea->acc = ea->acc - (ea->acc >> shift) + sample;
+
+    return (uint16_t)(ea->acc >> shift);
+}
+
+/**
+ * @brief Return the current value of an exponential average.
+ * @ingroup MOVING_AVERAGE
+ * @param ea Exponential average.
+ * @param shift log2 of the time constant, the one ea was declared with.
+ * @return The average; 0 before the first sample.
+ */
+static inline uint16_t exp_average_value(const ExpAverage *ea, uint8_t shift)
+{
+    return (uint16_t)(ea->acc >> shift);
+}
+
+/**
+ * @brief Forget every sample, so the average starts again from the next one.
+ * @ingroup MOVING_AVERAGE
+ * @param ea Exponential average.
+ */
+static inline void exp_average_reset(ExpAverage *ea)
+{
+    ea->acc = 0;
+    ea->primed = 0;
+}
+
+/**
+ * @brief Define a file-local MovingAverage, its window of 2^(window_shift) samples, and name_update(sample),
+ *        name_value() and name_reset(), with the shift built in as a constant.
+ * @param name Name of the MovingAverage; the window is name##_samples.
+ * @param window_shift log2 of the window, a compile-time constant from 0 to MOVING_AVERAGE_MAX_SHIFT.
+ */
+#define MOVING_AVERAGE(name, window_shift)                                                          \
+    static uint16_t name##_samples[1u << (window_shift)];                                           \
+    static MovingAverage name = {name##_samples, 0, 0, 0};                                          \
+    static inline uint16_t name##_update(uint16_t sample)                                           \
+        { return moving_average_update(&name, sample, (window_shift)); }                            \
+    static inline uint16_t name##_value(void) { return moving_average_value(&name, (window_shift)); } \
+    static inline void name##_reset(void) { moving_average_reset(&name); }                          \
+    _Static_assert((window_shift) <= MOVING_AVERAGE_MAX_SHIFT, #name ": window too long")
+
+/**
+ * @brief Define a file-local ExpAverage, and name_update(sample), name_value() and name_reset(), with the shift
+ *        built in as a constant.
+ * @param name Name of the ExpAverage.
+ * @param time_shift log2 of the time constant in samples, a compile-time constant from 0 to 16.
+ */
+#define EXP_AVERAGE(name, time_shift)                                                               \
+    static ExpAverage name = {0, 0};                                                                \
+    static inline uint16_t name##_update(uint16_t sample)                                           \
+        { return exp_average_update(&name, sample, (time_shift)); }                                 \
+    static inline uint16_t name##_value(void) { return exp_average_value(&name, (time_shift)); }    \
+    static inline void name##_reset(void) { exp_average_reset(&name); }                             \
+    _Static_assert((time_shift) <= 16, #name ": time constant too long")
+
+/** @} */
+#endif //MOVING_AVERAGE_H
@@ -0,0 +1,90 @@
+/**
+ * @file resume_state.c
+ * @brief Runtime state kept in information FRAM, so a reset or battery swap resumes instead of starting cold.
+ * @ingroup RESUME_STATE
+ */
+
+#include "resume_state.h"
+#include <stdint.h>
+#include "msp430fr2355.h"
+
+// information FRAM block, not initialised by the loader, so it survives a reset and a reflash
+#pragma DATA_SECTION(resume_slots, ".resume_state")
+ResumeSlot resume_slots[2];
+
+// private variables
+static uint8_t resume_newest = 1;   // slot written last, so the first save goes to slot 0
+
+// private functions
+uint16_t resume_checksum(const ResumeSlot *slot);
+uint8_t resume_slot_valid(const ResumeSlot *slot);
+
+/**
+ * @brief Private function to resume_state.c: checksum a slot.
+ * @ingroup RESUME_STATE
+ * @param slot Slot to checksum.
+ * @return Rotate-and-xor of every word before the check field, seeded with sizeof(ResumeSlot), so a block written by
+ *         a build with another layout does not pass.
+ * @note This is an internal helper; it is not exposed in the public header.
+ */
+uint16_t resume_checksum(const ResumeSlot *slot)
+{
+    const uint16_t *word = (const uint16_t *)slot;
+    const uint16_t *end = &slot->check;
+    uint16_t sum = sizeof(ResumeSlot);
+
+    for (; word < end; word++)
+    {
+        sum = (uint16_t)((sum << 1) | (sum >> 15)) ^ *word;
+    }
+    return sum;
+}
+
+/**
+ * @brief Private function to resume_state.c: check a slot holds a complete snapshot of this version.
+ * @ingroup RESUME_STATE
+ * @param slot Slot to check.
+ * @return 1 if valid.
+ * @note This is an internal helper; it is not exposed in the public header.
+ */
+uint8_t resume_slot_valid(const ResumeSlot *slot)
+{
+    return (slot->version == RESUME_STATE_VERSION) && (slot->check == resume_checksum(slot));
+}
+
+void resume_state_save(const ResumeState *state)
+{
+    uint8_t next = resume_newest ^ 1;
+    ResumeSlot *slot = &resume_slots[next];
+    uint16_t sequence = resume_slots[resume_newest].sequence + 1;
+
+    SYSCFG0 = FRWPPW | PFWP;                // information FRAM writable, program FRAM still protected
+    slot->version = RESUME_STATE_VERSION;
+    slot->sequence = sequence;
+    slot->state = *state;
+    slot->check = resume_checksum(slot);    // last, so a part-written slot fails its check
+    SYSCFG0 = FRWPPW | DFWP | PFWP;
+    resume_newest = next;
+}
+
+uint8_t resume_state_load(ResumeState *state)
+{
+    uint8_t valid0 = resume_slot_valid(&resume_slots[0]);
+    uint8_t valid1 = resume_slot_valid(&resume_slots[1]);
+
+    if (!valid0 && !valid1)
+    {
+        return 0;
+    }
+    // both valid: the newer one, by sequence number with wraparound
+    if (valid0 && (!valid1 || (int16_t)(resume_slots[0].sequence - resume_slots[1].sequence) > 0))
+    {
+        resume_newest = 0;
+    }
+    else
+    {
+        resume_newest = 1;
+    }
+    *state = resume_slots[resume_newest].state;
+    return 1;
+}
@@ -0,0 +1,60 @@
+/**
+ * @file resume_state.h
+ * @brief Runtime state kept in information FRAM, so a reset or battery swap resumes instead of starting cold.
+ */
+
+#ifndef RESUME_STATE_H
+#define RESUME_STATE_H
+
+#include <stdint.h>
+#include "led_control.h"
+
+/**
+ * @defgroup RESUME_STATE Resume state
+ * @brief Runtime state kept in information FRAM, so a reset or battery swap resumes instead of starting cold.
+ * @{
+ */
+
+#define RESUME_STATE_VERSION    2   // bump whenever ResumeState changes meaning; a block of another version is ignored
+
+/** What is kept across a reset. Filtered values rather than filter histories: a filter restarts from its value. */
+typedef struct
+{
+    LedIters iters;                 // animation phase: iterator of each group's active LED
+    LedActiveTracker track;         // animation phase: step of each group within its sequence
+    uint16_t light_average;         // filtered ambient light measurement
+    uint16_t battery_average;       // filtered battery voltage in mV, as the duty governor saw it
+    uint8_t batt_low_counter;       // low readings in a row, so the count carries on across a brown-out reset
+    uint8_t batt_cutoff;            // 1 once the BATT_LOW cutoff has turned the LEDs off, so a flat cell stays off
+} ResumeState;
+
+/** One copy of the state. Two of them are written in turn, so a reset part-way through a write leaves the other. */
+typedef struct
+{
+    uint16_t version;               // RESUME_STATE_VERSION
+    uint16_t sequence;              // the valid slot with the higher sequence is the newer
+    ResumeState state;
+    uint16_t check;                 // checksum over everything above, seeded with the layout size
+} ResumeSlot;
+
+// information FRAM slots, placed in .resume_state by the linker command file; read back by the host simulator
+extern ResumeSlot resume_slots[2];
+
+/**
+ * @brief Save a snapshot of the runtime state.
+ * @ingroup RESUME_STATE
+ * @param state State to save.
+ * @note Writes the older slot, so about 30 bytes and a checksum; lifts information FRAM write protection for the copy.
+ */
+void resume_state_save(const ResumeState *state);
+
+/**
+ * @brief Load the newest valid snapshot.
+ * @ingroup RESUME_STATE
+ * @param state Filled in with the snapshot.
+ * @return 1 if a snapshot of this version and layout was found, 0 if the device has to start cold.
+ */
+uint8_t resume_state_load(ResumeState *state);
+
+/** @} */
+#endif //RESUME_STATE_H
@@ -0,0 +1,80 @@
+/**
+ * @file task_scheduler.c
+ * @brief Stackless cooperative tasks: protothread bodies with per-task periods, deadlines and run-time accounting.
+ * @ingroup TASK_SCHEDULER
+ */
+
+#include "task_scheduler.h"
+#include "drivers/clock.h"
+#include <stdint.h>
+
+void task_account(Task *task, uint16_t start, uint8_t result)
+{
+#if TASK_STATS_ENABLE
+    uint16_t now = task_timer_now();
+    uint16_t run = now - start;
+
+    task->stats.run_time += run;
+    if (run > task->stats.max_run)
+    {
+        task->stats.max_run = run;
+    }
+    if (result == PT_ENDED)
+    {
+        task->stats.jobs += 1;
+        if ((uint16_t)(now - task->release) > task->deadline)
+        {
+            task->stats.misses += 1;
+        }
+    }
+#endif
+}
+
+void scheduler_release_due(Task tasks[], uint8_t count)
+{
+    uint16_t now = task_timer_now();
+    uint16_t next = 0xFFFF;
+    uint8_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        Task *task = &tasks[i];
+
+        if (!task->period || (uint16_t)(now - task->release) < task->period)
+        {
+            continue;
+        }
+        task->release += task->period;
+        if ((uint16_t)(now - task->release) >= task->period)
+        {
+            task->release = now;    // a whole period behind: start the grid again from now
+        }
+#if TASK_STATS_ENABLE
+        if (task->active)
+        {
+            task->stats.misses += 1;
+        }
+#endif
+        task->active = 1;
+        task_run(task);
+    }
+
+    // sleep until the earliest release - worked out after the jobs above ran, since they take time too
+    now = task_timer_now();
+    for (i = 0; i < count; i++)
+    {
+        uint16_t elapsed = now - tasks[i].release;
+        uint16_t wait;
+
+        if (!tasks[i].period)
+        {
+            continue;
+        }
+        wait = (elapsed >= tasks[i].period) ? 1 : tasks[i].period - elapsed;
+        if (wait < next)
+        {
+            next = wait;
+        }
+    }
+    task_timer_wake_in(next);
+}
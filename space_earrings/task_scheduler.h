@@ -0,0 +1,133 @@
+/**
+ * @file task_scheduler.h
+ * @brief Stackless cooperative tasks: protothread bodies with per-task periods, deadlines and run-time accounting.
+ */
+
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <stdint.h>
+#include "drivers/clock.h"
+
+/**
+ * @defgroup TASK_SCHEDULER Task scheduler
+ * @brief Stackless cooperative tasks: protothread bodies with per-task periods, deadlines and run-time accounting.
+ * @{
+ */
+
+#ifndef TASK_STATS_ENABLE
+#define TASK_STATS_ENABLE       0   // 1 = per-task run time and deadline misses; reads the task timer around every run
+#endif
+
+#define TASK_MS(ms)             ((uint16_t)((uint32_t)(ms) * TASK_TIMER_HZ / 1000u)) // task timer counts, up to 1999 ms
+
+// task body return values
+#define PT_WAITING              0   // the job is waiting or has yielded; it carries on from there at the next task_run()
+#define PT_ENDED                1   // the job reached PT_END; the next release starts it from PT_BEGIN
+
+// protothread continuations: the body is a switch on task->lc, so a waiting job keeps no stack. Locals do not survive
+// a wait or a yield - keep anything a job needs across one in a static. No switch statements around a wait or yield.
+#define PT_BEGIN(task)              switch ((task)->lc) { case 0:
+#define PT_WAIT_UNTIL(task, cond)   do { (task)->lc = __LINE__; if (0) { case __LINE__:; } if (!(cond)) return PT_WAITING; } while (0)
+#define PT_YIELD(task)              do { (task)->lc = __LINE__; return PT_WAITING; case __LINE__:; } while (0)
+#define PT_END(task)                } (task)->lc = 0; return PT_ENDED
+
+typedef struct Task Task;
+
+/** Task body: runs the job from where it last waited, returns PT_WAITING or PT_ENDED. */
+typedef uint8_t (*TaskBody)(Task *task);
+
+/** Per-task accounting, in task timer counts (~30.5 us). A single run is read to within a count; totals average out. */
+typedef struct
+{
+    uint32_t jobs;          // jobs that reached PT_END
+    uint32_t run_time;      // counts spent in the body, over every run
+    uint16_t max_run;       // longest single run of the body
+    uint16_t misses;        // jobs that ended after their deadline, or were still running at their next release
+} TaskStats;
+
+/** One task. The table of them lives with the application; the scheduler only walks it. */
+struct Task
+{
+    TaskBody body;
+    uint16_t period;        // task timer counts between releases, under 2 s; 0 = released by task_release() only
+    uint16_t deadline;      // task timer counts from release to the end of the job
+    uint16_t release;       // task timer time of the latest release
+    uint16_t lc;            // protothread continuation; 0 = at PT_BEGIN
+    uint8_t active;         // released and not yet at PT_END
+#if TASK_STATS_ENABLE
+    TaskStats stats;
+#endif
+};
+
+/**
+ * @brief Account for one run of a task body.
+ * @ingroup TASK_SCHEDULER
+ * @param task Task that ran.
+ * @param start Task timer time the run started.
+ * @param result The body's return value.
+ * @note Called by task_run() with TASK_STATS_ENABLE.
+ */
+void task_account(Task *task, uint16_t start, uint8_t result);
+
+/**
+ * @brief Run one step of a released task's job: its body up to the next wait, yield or PT_END.
+ * @ingroup TASK_SCHEDULER
+ * @param task Task to run. Does nothing while it has no job released.
+ * @note Call from the event handler that a job waits on. Inline, since the animation runs through it every tick.
+ */
+static inline void task_run(Task *task)
+{
+    uint8_t result;
+#if TASK_STATS_ENABLE
+    uint16_t start;
+#endif
+
+    if (!task->active)
+    {
+        return;
+    }
+#if TASK_STATS_ENABLE
+    start = task_timer_now();
+#endif
+    result = task->body(task);
+    if (result == PT_ENDED)
+    {
+        task->active = 0;
+    }
+#if TASK_STATS_ENABLE
+    task_account(task, start, result);
+#endif
+}
+
+/**
+ * @brief Release a job of an event-driven task and run its first step.
+ * @ingroup TASK_SCHEDULER
+ * @param task Task to release. If its last job is still waiting, that job carries on instead.
+ */
+static inline void task_release(Task *task)
+{
+#if TASK_STATS_ENABLE
+    if (!task->active)
+    {
+        task->release = task_timer_now();
+    }
+#endif
+    task->active = 1;
+    task_run(task);
+}
+
+/**
+ * @brief Release every periodic task that is due, run its first step, then sleep the task timer until the earliest
+ *        next release.
+ * @ingroup TASK_SCHEDULER
+ * @param tasks Task table.
+ * @param count Entries in the table.
+ * @note Call on EVENT_DEADLINE. Releases are kept on the period grid, so they do not drift with how late the
+ *       interrupt is handled. A task still running at its next release keeps running and, with TASK_STATS_ENABLE,
+ *       counts a miss.
+ */
+void scheduler_release_due(Task tasks[], uint8_t count);
+
+/** @} */
+#endif //TASK_SCHEDULER_H
@@ -0,0 +1,76 @@
+/**
+ * @file tick_stats.c
+ * @brief Animation tick overrun and latency statistics, kept in FRAM.
+ * @ingroup TICK_STATS
+ */
+
+#include "tick_stats.h"
+#include "drivers/clock.h"
+#include <stdint.h>
+#include "msp430fr2355.h"
+
+// FRAM-backed statistics block
+#pragma PERSISTENT(tick_stats)
+TickStats tick_stats = {0};
+
+// private functions
+void stats_unlock(void);
+void stats_lock(void);
+
+/**
+ * @brief Private function to tick_stats.c: allow writes to program FRAM, where PERSISTENT variables live.
+ * @ingroup TICK_STATS
+ * @note This is an internal helper; it is not exposed in the public header.
+ */
+void stats_unlock(void)
+{
+    SYSCFG0 = FRWPPW | DFWP;
+}
+
+/**
+ * @brief Private function to tick_stats.c: write-protect program FRAM again.
+ * @ingroup TICK_STATS
+ * @note This is an internal helper; it is not exposed in the public header.
+ */
+void stats_lock(void)
+{
+    SYSCFG0 = FRWPPW | DFWP | PFWP;
+}
+
+void tick_stats_record(uint8_t ticks, uint16_t latency)
+{
+    uint8_t bin = (uint8_t)((latency > ((TICK_STATS_BINS - 1) << TICK_STATS_BIN_SHIFT)) ? (TICK_STATS_BINS - 1) : (latency >> TICK_STATS_BIN_SHIFT));
+
+    stats_unlock();
+    tick_stats.ticks += 1;
+    if (ticks > 1)
+    {
+        tick_stats.missed_ticks += ticks - 1;
+    }
+    if (latency >= TICK_ACLK_COUNTS)
+    {
+        tick_stats.overruns += 1;
+    }
+    if (latency > tick_stats.max_latency)
+    {
+        tick_stats.max_latency = latency;
+    }
+    tick_stats.latency_hist[bin] += 1;
+    stats_lock();
+}
+
+void tick_stats_clear(void)
+{
+    uint8_t i;
+
+    stats_unlock();
+    tick_stats.ticks = 0;
+    tick_stats.missed_ticks = 0;
+    tick_stats.overruns = 0;
+    tick_stats.max_latency = 0;
+    for (i = 0; i < TICK_STATS_BINS; i++)
+    {
+        tick_stats.latency_hist[i] = 0;
+    }
+    stats_lock();
+}
@@ -0,0 +1,53 @@
+/**
+ * @file tick_stats.h
+ * @brief Animation tick overrun and latency statistics, kept in FRAM.
+ */
+
+#ifndef TICK_STATS_H
+#define TICK_STATS_H
+
+#include <stdint.h>
+
+/**
+ * @defgroup TICK_STATS Tick timing statistics
+ * @brief Animation tick overrun and latency statistics, kept in FRAM.
+ * @{
+ */
+
+#ifndef TICK_STATS_ENABLE
+#define TICK_STATS_ENABLE       0   // 1 = record every tick; a timing-validation build, it adds roughly a quarter to the tick cost
+#endif
+
+#define TICK_STATS_BINS         8   // latency histogram bins
+#define TICK_STATS_BIN_SHIFT    2   // 4 ACLK counts (~122 us) per bin; the last bin takes everything above
+
+/** Statistics block. Lives in FRAM, so it survives a reset and can be read back by a debugger or the host simulator. */
+typedef struct
+{
+    uint32_t ticks;                         // tick handler runs
+    uint32_t missed_ticks;                  // ticks that arrived while an earlier one was still pending
+    uint32_t overruns;                      // handler runs that ended a whole tick or more after their tick
+    uint16_t max_latency;                   // ACLK counts from a tick's timer event to the end of its handler
+    uint32_t latency_hist[TICK_STATS_BINS]; // handler runs by latency >> TICK_STATS_BIN_SHIFT
+} TickStats;
+
+extern TickStats tick_stats;
+
+/**
+ * @brief Record one run of the tick handler.
+ * @ingroup TICK_STATS
+ * @param ticks Ticks that were pending when the handler ran, from timer_1ms_count_take(). Anything above 1 was missed.
+ * @param latency ACLK counts from the tick's timer event to now, from millis_timer_latency().
+ * @note Call at the end of the tick handler. Lifts FRAM write protection for the update.
+ */
+void tick_stats_record(uint8_t ticks, uint16_t latency);
+
+/**
+ * @brief Zero the statistics block.
+ * @ingroup TICK_STATS
+ * @note The block is not cleared at start-up, so figures from before a reset can still be read back.
+ */
+void tick_stats_clear(void);
+
+/** @} */
+#endif //TICK_STATS_H